@@ -0,0 +1,89 @@
+#include "boost_plant.h"
+#include "xc.h"
+
+#include <math.h>
+
+#include "../timer.h"
+
+#define PWM_PERIOD (1.0 / TMR2_FREQ)
+#define PWM_COUNTS (TMR2_RESET << 2)
+
+#define DIVIDER_RATIO (PLANT_DIVIDER_BOTTOM / (PLANT_DIVIDER_TOP + PLANT_DIVIDER_BOTTOM))
+
+static uint32_t gNoiseState = 1;
+
+void Plant_Init(struct Plant* plant, double vIn)
+{
+    plant->vIn = vIn;
+    plant->v = vIn - 0.7;
+    plant->i = 0;
+    plant->iIn = 0;
+    plant->load = 0;
+    plant->cathodes = 0;
+    plant->noise = 1;
+}
+
+static double LoadCurrent(const struct Plant* plant)
+{
+    double i = plant->v / (PLANT_DIVIDER_TOP + PLANT_DIVIDER_BOTTOM);
+    if (plant->v > PLANT_TUBE_MAINTAIN_V)
+    {
+        i += plant->cathodes * (plant->v - PLANT_TUBE_MAINTAIN_V) / PLANT_TUBE_RESISTANCE;
+    }
+
+    return i;
+}
+
+// The inductor current carries over between periods, so continuous conduction is handled as well as discontinuous.
+void Plant_Step(struct Plant* plant)
+{
+    double tOn = 0;
+    if (PWM3CONbits.EN) tOn = PWM_PERIOD * (PWM3DC >> 6) / PWM_COUNTS;
+
+    double tOff = PWM_PERIOD - tOn;
+    double charge = 0;
+
+    // The input always flows through the inductor.
+    double iStart = plant->i;
+    plant->i += plant->vIn * tOn / PLANT_INDUCTANCE;
+    double inputCharge = (iStart + plant->i) * tOn / 2;
+
+    // Below the input the diode conducts straight through the inductor.
+    double vL = plant->v - plant->vIn;
+    if (vL < 0.5) vL = 0.5;
+
+    double tDischarge = plant->i * PLANT_INDUCTANCE / vL;
+    if (tDischarge <= tOff)
+    {
+        charge = plant->i * tDischarge / 2;
+        plant->i = 0;
+    }
+    else
+    {
+        double iEnd = plant->i - vL * tOff / PLANT_INDUCTANCE;
+        charge = (plant->i + iEnd) * tOff / 2;
+        plant->i = iEnd;
+    }
+
+    plant->iIn = (inputCharge + charge) / PWM_PERIOD;
+    plant->load = LoadCurrent(plant);
+    plant->v += (charge - plant->load * PWM_PERIOD) / PLANT_CAPACITANCE;
+    if (plant->v < plant->vIn - 0.7) plant->v = plant->vIn - 0.7;
+}
+
+uint16_t Plant_SampleAdc(const struct Plant* plant)
+{
+    gNoiseState = gNoiseState * 1103515245u + 12345u;
+    int noise = (int)((gNoiseState >> 16) % (2 * plant->noise + 1)) - (int)plant->noise;
+
+    int adc = (int)lround(plant->v * DIVIDER_RATIO / PLANT_ADC_LSB) + noise;
+    if (adc < 0) adc = 0;
+    if (adc > 1023) adc = 1023;
+
+    return (uint16_t)adc;
+}
+
+double Plant_AdcToVolts(double adc)
+{
+    return adc * PLANT_ADC_LSB / DIVIDER_RATIO;
+}
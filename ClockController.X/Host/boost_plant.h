@@ -0,0 +1,54 @@
+#ifndef BOOST_PLANT_H
+#define	BOOST_PLANT_H
+
+/*
+ * Discrete-time model of the 180V boost stage for the host tools: inductor, output capacitor, the divider into the ADC,
+ * and the tube load. The PWM is read straight from the PWM3 registers of the xc.h shim, so firmware can drive it
+ * unmodified.
+ */
+
+#include <stdint.h>
+
+// Boost stage, from the schematic. The input defaults to the 12V PD contract preferred by AP33772_Init, limited to 1A.
+#define PLANT_V_IN 12.0
+#define PLANT_I_IN_MAX 1.0
+#define PLANT_INDUCTANCE 220e-6
+#define PLANT_CAPACITANCE 10e-6
+#define PLANT_DIVIDER_TOP 750e3
+#define PLANT_DIVIDER_BOTTOM 12e3
+#define PLANT_ADC_LSB 0.004
+
+// A lit IN-12 cathode maintains ~140V, and the driver board's anode resistor is 20k, so ~2mA at 180V.
+#define PLANT_TUBE_MAINTAIN_V 140.0
+#define PLANT_TUBE_RESISTANCE 20e3
+
+struct Plant
+{
+    double vIn;         // Input voltage, from the PD contract
+    double v;           // Output voltage
+    double i;           // Inductor current
+    double iIn;         // Input current averaged over the last period
+    double load;        // Load current drawn over the last period
+    double cathodes;    // Lit cathodes; fractional while cross-fading
+    unsigned noise;     // Peak ADC noise in LSBs, from switching and the reference
+};
+
+/// Starts the plant powered but not switching: the output sits a diode drop below the input.
+///
+/// @param vIn The input voltage, e.g. PLANT_V_IN.
+void Plant_Init(struct Plant* plant, double vIn);
+
+///
+/// Advances the plant by one PWM period, using the period and duty cycle in the PWM3 registers.
+void Plant_Step(struct Plant* plant);
+
+///
+/// Converts the output voltage to an ADC reading, with uniform noise of up to +/-noise LSBs.
+uint16_t Plant_SampleAdc(const struct Plant* plant);
+
+///
+/// The output voltage that gives the ADC reading.
+double Plant_AdcToVolts(double adc);
+
+#endif	/* BOOST_PLANT_H */
+
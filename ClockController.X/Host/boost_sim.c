@@ -0,0 +1,374 @@
+/*
+ * Host-side boost converter simulator for control-loop tuning.
+ *
+ * Runs the unmodified ADC interrupt handler and BoostConverter_Update against the model in boost_plant.c through a
+ * scripted load profile. For each step of the profile it reports settling time, overshoot, output ripple, duty cycle
+ * jitter, the peak input current and OVP trips, then the time to HV-ready and the total time outside HV_MIN-HV_MAX.
+ * It can also write a CSV trace of every ADC sample. Retuning the gains in boost_control.c is then an edit and a
+ * rebuild.
+ *
+ * Build and run from ClockController.X:
+ *     gcc -O2 -Wno-unknown-pragmas -I Host -o Host/boost_sim Host/boost_sim.c Host/boost_plant.c Host/xc.c boost_control.c adc.c pwm.c nvm.c -lm
+ *     Host/boost_sim [-o trace.csv] [-b band_volts] [-n noise_lsb] [-v input_volts] [-F] [-g] [profile]
+ *
+ * Add -DBOOST_CONTROL_STEPPER to the build to run the original stepper instead of the PI controller. Each load change
+ * is published to BoostConverter_SetExpectedLoad as nixie.c does; -F turns that off to see the loop without
+ * feedforward.
+ *
+ * With -g the profile waits for BoostConverter_HvReady, as main.c gates the tubes on it, and a "ready" line reports the
+ * soft-start on its own. The input current is averaged over INPUT_WINDOW_MS and compared with the PD contract. -v sets
+ * the contract's voltage (PLANT_V_IN by default), to check the other voltages AP33772_Init may settle for.
+ *
+ * A profile is a list of "<time ms> <lit cathodes> [fade ms]" lines, with '#' comments. Each line changes the load at
+ * its time, ramping over the fade (as the drivers cross-fade digits). A final "<time ms> end" line sets the length.
+ * See Host/profiles. Without a profile, the built-in copy of Host/profiles/load_steps.txt is run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "boost_plant.h"
+
+#include "../adc.h"
+#include "../boost_control.h"
+#include "../nixie.h"
+#include "../timer.h"
+
+// Matches ADC_SP in boost_control.c
+#define SETPOINT_ADC 721
+
+#define PERIODS_PER_SAMPLE (int)(TMR2_FREQ / ADC_SAMPLE_FREQ)
+#define SAMPLES_PER_MS (int)(ADC_SAMPLE_FREQ / 1000)
+
+// Ripple is measured over the end of each step, once it has had time to settle.
+#define RIPPLE_WINDOW_MS 100
+
+#define MAX_STEPS 256
+
+// The PD source's over-current protection doesn't trip on the switching ripple, so the input current is averaged.
+#define INPUT_WINDOW_MS 1
+
+// Give up waiting for HV-ready after this long.
+#define READY_TIMEOUT_MS 1000
+
+struct Step
+{
+    unsigned time;
+    double cathodes;
+    unsigned fade;
+};
+
+struct Stats
+{
+    double peak;
+    double dip;
+    double lo;
+    double hi;
+    double duty;
+    double dutyLo;
+    double dutyHi;
+    unsigned dutySamples;
+    long settle;
+    unsigned ovpTrips;
+    double inputPeak;
+};
+
+// The input current over the last INPUT_WINDOW_MS, one entry per ADC sample.
+static double gInput[INPUT_WINDOW_MS * SAMPLES_PER_MS];
+static double gInputSum = 0;
+static unsigned gInputIndex = 0;
+
+static const struct Step gDefaultProfile[] =
+{
+    { 0, 12, 0 },
+    { 500, 6, 0 },
+    { 1000, 12, 0 },
+    { 1500, 0, 0 },
+    { 2000, 0, 0 },
+};
+
+static struct Step gProfile[MAX_STEPS];
+static unsigned gStepCount = 0;
+
+static void Usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-o trace.csv] [-b band_volts] [-n noise_lsb] [-v input_volts] [-F] [-g] [profile]\n",
+        name);
+    exit(2);
+}
+
+// Reads the profile into gProfile. The last entry marks the end of the run.
+static void LoadProfile(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    char line[128];
+    unsigned lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        ++lineNumber;
+
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        unsigned time, fade = 0;
+        char load[16];
+        int fields = sscanf(line, "%u %15s %u", &time, load, &fade);
+        if (fields <= 0) continue;
+
+        uint8_t end = fields >= 2 && 0 == strcmp(load, "end");
+        char* parsed = load;
+        double cathodes = end ? (gStepCount ? gProfile[gStepCount - 1].cathodes : 0) : strtod(load, &parsed);
+
+        if (fields < 2 || (!end && *parsed))
+        {
+            fprintf(stderr, "%s:%u: expected <time ms> <cathodes> [fade ms] or <time ms> end\n", path, lineNumber);
+            exit(1);
+        }
+
+        if (gStepCount >= MAX_STEPS || (gStepCount && time <= gProfile[gStepCount - 1].time))
+        {
+            fprintf(stderr, "%s:%u: too many steps, or time not increasing\n", path, lineNumber);
+            exit(1);
+        }
+
+        gProfile[gStepCount++] = (struct Step){ time, cathodes, end ? 0 : fade };
+        if (end) break;
+    }
+
+    fclose(file);
+
+    if (gStepCount < 2)
+    {
+        fprintf(stderr, "%s: a profile needs at least one step and an end\n", path);
+        exit(1);
+    }
+}
+
+// The load at a time, including any fade in progress. Fades move in steps, as the drivers do.
+static double CathodesAt(unsigned step, double ms)
+{
+    const struct Step* current = &gProfile[step];
+    double from = step ? gProfile[step - 1].cathodes : 0;
+
+    if (!current->fade || ms >= current->time + current->fade) return current->cathodes;
+
+    unsigned fadeStep = (unsigned)((ms - current->time) * NIXIE_FADE_STEPS / current->fade);
+
+    return from + (current->cathodes - from) * fadeStep / NIXIE_FADE_STEPS;
+}
+
+// Runs the plant up to the next ADC sample and the firmware's handling of it.
+static void Sample(struct Plant* plant, struct Stats* stats)
+{
+    double input = 0;
+    for (int p = 0; p < PERIODS_PER_SAMPLE; ++p)
+    {
+        Plant_Step(plant);
+        input += plant->iIn / PERIODS_PER_SAMPLE;
+    }
+
+    gInputSum += input - gInput[gInputIndex];
+    gInput[gInputIndex] = input;
+    gInputIndex = (gInputIndex + 1) % (sizeof(gInput) / sizeof(gInput[0]));
+
+    double average = gInputSum / (sizeof(gInput) / sizeof(gInput[0]));
+    if (average > stats->inputPeak) stats->inputPeak = average;
+
+    uint8_t enabled = PWM3CONbits.EN;
+    ADRES = Plant_SampleAdc(plant);
+    AdcInterruptHandler();
+    if (enabled && !PWM3CONbits.EN) ++stats->ovpTrips;
+}
+
+static void Trace(FILE* trace, long n, const struct Plant* plant)
+{
+    fprintf(trace, "%.3f,%.2f,%.3f,%.4f,%.5f,%u,%.1f,%u,%u\n", (double)n / SAMPLES_PER_MS, plant->cathodes, plant->v,
+        plant->i, plant->load, ADRES, 100.0 * (PWM3DC >> 6) / (TMR2_RESET << 2), PWM3CONbits.EN,
+        BoostConverter_OverVoltageProtectionOn());
+}
+
+static void PrintStats(const char* label, double cathodes, const struct Stats* stats, long first, long last)
+{
+    char settle[16];
+    if (stats->settle >= last) snprintf(settle, sizeof(settle), "never");
+    else snprintf(settle, sizeof(settle), "%.1f", (double)(stats->settle - first) / SAMPLES_PER_MS);
+
+    // Ripple and duty cycle are only measured at the end of a profile step.
+    uint8_t steady = stats->dutySamples != 0;
+
+    printf("%8s %8.1f %10s %+8.1f %+8.1f %8.2f %8.1f %8.1f %8.2f %5u\n",
+        label, cathodes, settle, stats->peak, stats->dip, steady ? stats->hi - stats->lo : 0.0,
+        steady ? stats->duty / stats->dutySamples : 0.0, steady ? stats->dutyHi - stats->dutyLo : 0.0, stats->inputPeak,
+        stats->ovpTrips);
+}
+
+int main(int argc, char** argv)
+{
+    const char* tracePath = NULL;
+    double band = 2.0;
+    unsigned noise = 1;
+    int feedForward = 1;
+    int gate = 0;
+    double vIn = PLANT_V_IN;
+
+    int option;
+    while (-1 != (option = getopt(argc, argv, "o:b:n:v:Fg")))
+    {
+        switch (option)
+        {
+            case 'o': tracePath = optarg; break;
+            case 'b': band = atof(optarg); break;
+            case 'n': noise = (unsigned)atoi(optarg); break;
+            case 'v': vIn = atof(optarg); break;
+            case 'F': feedForward = 0; break;
+            case 'g': gate = 1; break;
+            default: Usage(argv[0]);
+        }
+    }
+
+    if (optind < argc - 1) Usage(argv[0]);
+
+    if (optind < argc)
+    {
+        LoadProfile(argv[optind]);
+    }
+    else
+    {
+        gStepCount = sizeof(gDefaultProfile) / sizeof(gDefaultProfile[0]);
+        memcpy(gProfile, gDefaultProfile, sizeof(gDefaultProfile));
+    }
+
+    FILE* trace = NULL;
+    if (tracePath)
+    {
+        trace = fopen(tracePath, "w");
+        if (!trace)
+        {
+            perror(tracePath);
+            return 1;
+        }
+
+        fprintf(trace, "time_ms,cathodes,v_out,i_l,i_load,adc,duty_pct,pwm_en,ovp\n");
+    }
+
+    double target = Plant_AdcToVolts(SETPOINT_ADC);
+
+    printf("controller: %s%s, update %lu Hz, setpoint %.1f V, band +/-%.1f V, noise +/-%u LSB, input %.1f V %.1f A\n",
+#ifdef BOOST_CONTROL_STEPPER
+        "stepper",
+#else
+        "PI",
+#endif
+        feedForward ? " + feedforward" : "", (unsigned long)ADC_UPDATE_FREQ, target, band, noise, vIn,
+        PLANT_I_IN_MAX);
+    printf("%8s %8s %10s %8s %8s %8s %8s %8s %8s %5s\n", "time ms", "cathodes", "settle ms", "peak V", "dip V",
+        "ripple V", "duty %", "p-p %", "peak A", "ovp");
+
+    struct Plant plant;
+    Plant_Init(&plant, vIn);
+    plant.noise = noise;
+
+    PWM3CONbits.EN = 1;
+    BoostConverter_Init();
+
+    unsigned totalTrips = 0;
+    long outOfRange = 0;
+    long ready = -1;
+    double inputPeak = 0;
+
+    // The profile starts once HV is ready, with the tubes blank until then.
+    long start = 0;
+    if (gate)
+    {
+        struct Stats stats = { -1e9, 1e9, 1e9, -1e9, 0, 1e9, -1e9, 0, 0, 0, 0 };
+
+        while (!BoostConverter_HvReady() && start < READY_TIMEOUT_MS * SAMPLES_PER_MS)
+        {
+            plant.cathodes = 0;
+            Sample(&plant, &stats);
+
+            double error = plant.v - target;
+            if (error > stats.peak) stats.peak = error;
+            if (error < stats.dip) stats.dip = error;
+
+            if (trace) Trace(trace, start, &plant);
+            ++start;
+        }
+
+        // The soft-start has settled when it reports ready.
+        if (BoostConverter_HvReady()) ready = start;
+        stats.settle = start;
+        PrintStats("ready", 0, &stats, 0, ready < 0 ? start : start + 1);
+        totalTrips += stats.ovpTrips;
+        inputPeak = stats.inputPeak;
+    }
+
+    for (unsigned step = 0; step + 1 < gStepCount; ++step)
+    {
+        long first = (long)gProfile[step].time * SAMPLES_PER_MS;
+        long last = (long)gProfile[step + 1].time * SAMPLES_PER_MS;
+        long steady = last - RIPPLE_WINDOW_MS * SAMPLES_PER_MS;
+        if (steady < first) steady = first;
+
+        struct Stats stats = { -1e9, 1e9, 1e9, -1e9, 0, 1e9, -1e9, 0, first, 0, 0 };
+
+        for (long n = first; n < last; ++n)
+        {
+            double ms = (double)n / SAMPLES_PER_MS;
+            plant.cathodes = CathodesAt(step, ms);
+            if (feedForward) BoostConverter_SetExpectedLoad((uint8_t)lround(plant.cathodes * NIXIE_DIGIT_LOAD));
+
+            Sample(&plant, &stats);
+            if (ready < 0 && !gate && BoostConverter_HvReady()) ready = n + 1;
+
+            double duty = 100.0 * (PWM3DC >> 6) / (TMR2_RESET << 2);
+            double error = plant.v - target;
+
+            // Settled after the last sample outside the band.
+            if (fabs(error) > band) stats.settle = n + 1;
+            if (error > stats.peak) stats.peak = error;
+            if (error < stats.dip) stats.dip = error;
+
+            // The tubes are blanked outside this range, so count the time out of it once started.
+            if (step && (plant.v < HV_MIN || plant.v > HV_MAX)) ++outOfRange;
+
+            if (n >= steady)
+            {
+                if (plant.v < stats.lo) stats.lo = plant.v;
+                if (plant.v > stats.hi) stats.hi = plant.v;
+                stats.duty += duty;
+                if (duty < stats.dutyLo) stats.dutyLo = duty;
+                if (duty > stats.dutyHi) stats.dutyHi = duty;
+                ++stats.dutySamples;
+            }
+
+            if (trace) Trace(trace, start + n, &plant);
+        }
+
+        char label[16];
+        snprintf(label, sizeof(label), "%u", gProfile[step].time);
+        PrintStats(label, gProfile[step].cathodes, &stats, first, last);
+        totalTrips += stats.ovpTrips;
+        if (stats.inputPeak > inputPeak) inputPeak = stats.inputPeak;
+    }
+
+    if (ready < 0) printf("HV ready: never\n");
+    else printf("HV ready: %.1f ms\n", (double)ready / SAMPLES_PER_MS);
+
+    printf("Peak input current: %.2f A%s\n", inputPeak, inputPeak > PLANT_I_IN_MAX ? " (over the PD contract)" : "");
+    printf("OVP trips: %u\n", totalTrips);
+    printf("Outside %u-%u V after start-up: %.1f ms\n", HV_MIN, HV_MAX, (double)outOfRange / SAMPLES_PER_MS);
+
+    if (trace) fclose(trace);
+
+    return 0;
+}
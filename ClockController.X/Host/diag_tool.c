@@ -0,0 +1,483 @@
+/*
+ * Host-side tool for the diagnostic protocol in diag.h.
+ *
+ * Reads the clock's EUSART TX line from a serial device (e.g. a USB serial adapter at GPS_BAUD) or a raw capture file,
+ * decodes the SLIP frames, checks their CRCs, and logs one line per record to stdout. Telemetry records are written
+ * as CSV to the file given with -t, with times relative to the trigger. Bad frames, including any bytes between frames,
+ * are counted, not logged.
+ *
+ * Settings are written with -z (time zone offset and DST type) and -i (records interval), which need the device to be
+ * wired to the clock's RX pin. The clock answers each with an ACK record. It holds one ACK at a time, so the commands
+ * are spaced out by more than DIAG_PERIOD.
+ *
+ * Build and run from ClockController.X:
+ *     gcc -O2 -Wno-unknown-pragmas -I Host -o Host/diag_tool Host/diag_tool.c Host/xc.c diag.c serial.c ring_buffer.c
+ *     Host/diag_tool -b 57600 -t telemetry.csv /dev/ttyUSB0
+ *     Host/diag_tool capture.bin
+ *
+ * Without -g, telemetry voltages use the nominal divider (see BoostConverter_GetVoltage).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "../diag.h"
+#include "../telemetry.h"
+#include "../gps_config.h"
+#include "../i2c.h"
+#include "../boot.h"
+
+#define DEFAULT_VOLTS_PER_COUNT (1.0 / 4 - 1.0 / 330)
+
+// A telemetry record is the longest.
+#define FRAME_MAX 512
+
+// Longer than DIAG_PERIOD in main.c, so each command is answered before the next.
+#define COMMAND_SPACING_US 300000
+
+struct Decoder
+{
+    uint8_t frame[FRAME_MAX];
+    size_t len;
+    int escape;
+    int overflow;
+
+    unsigned frames;
+    unsigned badFrames;
+    unsigned telemetryRecords;
+
+    FILE* telemetry;
+    double voltsPerCount;
+};
+
+static const char* CONFIG_STATES[] = { "pending", "verifying", "ok", "failed" };
+static const char* ACK_STATUS[] = { "ok", "unknown setting", "invalid value" };
+static const char* BOOT_STATES[] = { "pd", "hv", "done", "failed" };
+static const char* BOOT_MILESTONES[BOOT_MILESTONE_COUNT] = { "display", "pd", "hv", "tubes", "gps-config", "gps-time" };
+static const char* I2C_DEVICES[I2C_DEVICE_COUNT] = { "nixie", "oled", "pd", "rtc", "other" };
+
+static unsigned U16(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+static int S16(const uint8_t* data)
+{
+    return (int16_t)U16(data);
+}
+
+static void LogPrefix(const uint8_t* frame, const char* name)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    struct tm local;
+    localtime_r(&now.tv_sec, &local);
+
+    printf("%02d:%02d:%02d.%03ld #%03u %-10s", local.tm_hour, local.tm_min, local.tm_sec, (long)(now.tv_usec / 1000),
+        frame[1], name);
+}
+
+static void LogTime(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 14) return;
+
+    LogPrefix(frame, "TIME");
+    printf("20%02u-%02u-%02u %02u:%02u:%02u gps=%c cfg=%s pps=%u writes=%u",
+        p[0], p[1], p[2], p[3], p[4], p[5], p[6] ? p[6] : '-', p[7] < 4 ? CONFIG_STATES[p[7]] : "?", p[8], p[9]);
+
+    int phase = S16(p + 10);
+    if (INT16_MIN == phase) printf(" phase=---");
+    else printf(" phase=%+.1fms", phase / 10.0);
+
+    int drift = S16(p + 12);
+    if (INT16_MIN == drift) printf(" drift=---\n");
+    else printf(" drift=%+.2fppm\n", drift / 100.0);
+}
+
+static void LogBoost(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 11) return;
+
+    LogPrefix(frame, "BOOST");
+    printf("%.1fV duty=%u%s%s%s excursions=%u last=%ums longest=%ums\n",
+        U16(p) / 10.0, U16(p + 2),
+        (p[4] & DIAG_BOOST_OVP) ? " OVP" : "",
+        (p[4] & DIAG_BOOST_HV_READY) ? " ready" : " not-ready",
+        (p[4] & DIAG_BOOST_HV_IN_RANGE) ? "" : " out-of-range",
+        U16(p + 5), U16(p + 7), U16(p + 9));
+}
+
+static void LogPd(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 9) return;
+
+    LogPrefix(frame, "PD");
+    printf("status=0x%02X %.2fV %.2fA %uC pdo=%u (%uV %uA)\n",
+        p[0], U16(p + 1) / 1000.0, U16(p + 3) / 1000.0, p[8], p[5], p[6], p[7]);
+}
+
+static void LogI2c(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 2 + I2C_DEVICE_COUNT * 3) return;
+
+    LogPrefix(frame, "I2C");
+    printf("errors=%u resets=%u", p[0], p[1]);
+
+    for (int i = 0; i < I2C_DEVICE_COUNT; ++i)
+    {
+        const uint8_t* device = p + 2 + i * 3;
+        printf(" %s=%u/%u", I2C_DEVICES[i], U16(device), device[2]);
+    }
+
+    printf("\n");
+}
+
+static void LogNixie(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 2) return;
+
+    LogPrefix(frame, "NIXIE");
+    printf("status=0x%04X\n", U16(p));
+}
+
+static void LogBoot(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 2 + BOOT_MILESTONE_COUNT * 2) return;
+
+    LogPrefix(frame, "BOOT");
+    printf("state=%s%s", p[0] < 4 ? BOOT_STATES[p[0]] : "?", (p[1] & DIAG_BOOT_PD_LOW_POWER) ? " low-power" : "");
+
+    for (int i = 0; i < BOOT_MILESTONE_COUNT; ++i)
+    {
+        unsigned time = U16(p + 2 + i * 2);
+        if (BOOT_NOT_REACHED == time) printf(" %s=---", BOOT_MILESTONES[i]);
+        else printf(" %s=%.2fs", BOOT_MILESTONES[i], time * BOOT_TIME_UNIT_MS / 1000.0);
+    }
+
+    printf("\n");
+}
+
+static void LogAck(const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < 2) return;
+
+    LogPrefix(frame, "ACK");
+    printf("setting=%u %s\n", p[0], p[1] < 3 ? ACK_STATUS[p[1]] : "?");
+}
+
+static void LogTelemetry(struct Decoder* decoder, const uint8_t* frame, const uint8_t* p, size_t len)
+{
+    if (len < TELEMETRY_HEADER_SIZE) return;
+
+    unsigned event = p[0];
+    unsigned count = p[1];
+    unsigned trigger = p[2];
+    int periodUs = (int)U16(p + 4);
+    unsigned pwmPeriod = U16(p + 6);
+
+    if (len < TELEMETRY_HEADER_SIZE + count * TELEMETRY_SAMPLE_SIZE || !pwmPeriod) return;
+    if (TELEMETRY_NO_TRIGGER == trigger || trigger >= count) trigger = 0;
+
+    unsigned record = decoder->telemetryRecords++;
+
+    LogPrefix(frame, "TELEMETRY");
+    printf("record=%u samples=%u period=%dus trigger=%s%s\n", record, count, periodUs,
+        (event & TELEMETRY_EVENT_OVP) ? "ovp " : "", (event & TELEMETRY_EVENT_WINDOW) ? "window" : "");
+
+    if (!decoder->telemetry) return;
+
+    const uint8_t* sample = p + TELEMETRY_HEADER_SIZE;
+    for (unsigned i = 0; i < count; ++i, sample += TELEMETRY_SAMPLE_SIZE)
+    {
+        unsigned adc = sample[0] | ((sample[1] & 0x0F) << 8);
+        unsigned duty = (sample[1] >> 4) | ((sample[2] & 0x3F) << 4);
+        unsigned flags = sample[2] >> 6;
+
+        double ms = ((int)i - (int)trigger) * periodUs / 1000.0;
+        double counts = adc / 4.0;
+
+        fprintf(decoder->telemetry, "%u,%u,%.3f,%.2f,%.2f,%.2f,%u,%u,%u\n",
+            record, i, ms, counts, counts * decoder->voltsPerCount, 100.0 * duty / pwmPeriod,
+            !!(flags & TELEMETRY_EVENT_OVP), !!(flags & TELEMETRY_EVENT_WINDOW), event);
+    }
+
+    fflush(decoder->telemetry);
+}
+
+static void HandleFrame(struct Decoder* decoder)
+{
+    const uint8_t* frame = decoder->frame;
+    size_t len = decoder->len;
+
+    // type, sequence, CRC at the least. The CRC over the frame and its own CRC is 0.
+    if (len < 3 || decoder->overflow)
+    {
+        ++decoder->badFrames;
+        return;
+    }
+
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i) crc = Diag_Crc8(crc, frame[i]);
+    if (crc)
+    {
+        ++decoder->badFrames;
+        return;
+    }
+
+    ++decoder->frames;
+
+    const uint8_t* payload = frame + 2;
+    len -= 3;
+
+    switch (frame[0])
+    {
+        case DIAG_RECORD_TIME: LogTime(frame, payload, len); break;
+        case DIAG_RECORD_BOOST: LogBoost(frame, payload, len); break;
+        case DIAG_RECORD_PD: LogPd(frame, payload, len); break;
+        case DIAG_RECORD_I2C: LogI2c(frame, payload, len); break;
+        case DIAG_RECORD_NIXIE: LogNixie(frame, payload, len); break;
+        case DIAG_RECORD_BOOT: LogBoot(frame, payload, len); break;
+        case DIAG_RECORD_ACK: LogAck(frame, payload, len); break;
+        case DIAG_RECORD_TELEMETRY: LogTelemetry(decoder, frame, payload, len); break;
+        default:
+            LogPrefix(frame, "?");
+            printf("type=0x%02X length=%zu\n", frame[0], len);
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static void Decode(struct Decoder* decoder, uint8_t data)
+{
+    if (DIAG_SLIP_END == data)
+    {
+        // Back-to-back ENDs delimit nothing.
+        if (decoder->len || decoder->overflow) HandleFrame(decoder);
+
+        decoder->len = 0;
+        decoder->escape = 0;
+        decoder->overflow = 0;
+        return;
+    }
+
+    if (DIAG_SLIP_ESC == data)
+    {
+        decoder->escape = 1;
+        return;
+    }
+
+    if (decoder->escape)
+    {
+        if (DIAG_SLIP_ESC_END == data) data = DIAG_SLIP_END;
+        else if (DIAG_SLIP_ESC_ESC == data) data = DIAG_SLIP_ESC;
+
+        decoder->escape = 0;
+    }
+
+    if (decoder->len < FRAME_MAX) decoder->frame[decoder->len++] = data;
+    else decoder->overflow = 1;
+}
+
+static void PutEscaped(uint8_t* out, size_t* len, uint8_t data)
+{
+    if (DIAG_SLIP_END == data)
+    {
+        out[(*len)++] = DIAG_SLIP_ESC;
+        out[(*len)++] = DIAG_SLIP_ESC_END;
+    }
+    else if (DIAG_SLIP_ESC == data)
+    {
+        out[(*len)++] = DIAG_SLIP_ESC;
+        out[(*len)++] = DIAG_SLIP_ESC_ESC;
+    }
+    else
+    {
+        out[(*len)++] = data;
+    }
+}
+
+static int SendSetting(int fd, uint8_t sequence, uint8_t setting, int value)
+{
+    uint8_t frame[5] = { DIAG_COMMAND_WRITE, sequence, setting, (uint8_t)value, (uint8_t)(value >> 8) };
+
+    uint8_t out[2 + 2 * (sizeof(frame) + 1)];
+    size_t len = 0;
+    uint8_t crc = 0;
+
+    out[len++] = DIAG_SLIP_END;
+    for (size_t i = 0; i < sizeof(frame); ++i)
+    {
+        crc = Diag_Crc8(crc, frame[i]);
+        PutEscaped(out, &len, frame[i]);
+    }
+
+    PutEscaped(out, &len, crc);
+    out[len++] = DIAG_SLIP_END;
+
+    return write(fd, out, len) == (ssize_t)len ? 0 : -1;
+}
+
+static speed_t BaudConstant(long baud)
+{
+    switch (baud)
+    {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        default: return 0;
+    }
+}
+
+static int ConfigureTty(int fd, long baud)
+{
+    speed_t speed = BaudConstant(baud);
+    if (!speed)
+    {
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty)) return -1;
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+
+    return tcsetattr(fd, TCSANOW, &tty);
+}
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [-b baud] [-t telemetry.csv] [-g volts_per_count] [-z offset,dst] [-i interval] device|capture\n"
+        "  -b  serial baud rate (default %lu)\n"
+        "  -t  append telemetry samples to a CSV file\n"
+        "  -g  volts per ADC count for the telemetry CSV\n"
+        "  -z  set the time zone offset [-12..14] and DST type (0 off, 1 US)\n"
+        "  -i  set the Diag_Task calls between records (0 stops the stream)\n",
+        name, GPS_BAUD);
+}
+
+int main(int argc, char** argv)
+{
+    struct Decoder decoder = { 0 };
+    decoder.voltsPerCount = DEFAULT_VOLTS_PER_COUNT;
+
+    long baud = GPS_BAUD;
+    const char* telemetryPath = NULL;
+    int timeZone = 0, haveTimeZone = 0;
+    int interval = 0, haveInterval = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:g:z:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': baud = atol(optarg); break;
+            case 't': telemetryPath = optarg; break;
+            case 'g': decoder.voltsPerCount = atof(optarg); break;
+            case 'z':
+            {
+                int offset = 0, dst = 0;
+                if (sscanf(optarg, "%d,%d", &offset, &dst) < 1)
+                {
+                    Usage(argv[0]);
+                    return 1;
+                }
+
+                timeZone = (uint8_t)offset | (dst << 8);
+                haveTimeZone = 1;
+                break;
+            }
+            case 'i':
+                interval = atoi(optarg);
+                haveInterval = 1;
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[optind];
+    int flags = (haveTimeZone || haveInterval) ? O_RDWR | O_NOCTTY : O_RDONLY | O_NOCTTY;
+    int fd = strcmp(path, "-") ? open(path, flags) : 0;
+    if (fd < 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    if (isatty(fd) && ConfigureTty(fd, baud))
+    {
+        perror(path);
+        return 1;
+    }
+
+    if (telemetryPath)
+    {
+        decoder.telemetry = fopen(telemetryPath, "a");
+        if (!decoder.telemetry)
+        {
+            perror(telemetryPath);
+            return 1;
+        }
+
+        if (!ftell(decoder.telemetry))
+        {
+            fprintf(decoder.telemetry, "record,sample,ms,adc,volts,duty_pct,ovp,window,trigger\n");
+        }
+    }
+
+    uint8_t sequence = 0;
+    if (haveTimeZone && SendSetting(fd, sequence++, DIAG_SETTING_TIME_ZONE, timeZone))
+    {
+        perror(path);
+        return 1;
+    }
+
+    if (haveInterval)
+    {
+        if (sequence) usleep(COMMAND_SPACING_US);
+
+        if (SendSetting(fd, sequence++, DIAG_SETTING_INTERVAL, interval))
+        {
+            perror(path);
+            return 1;
+        }
+    }
+
+    // Runs until the capture ends, or forever on a device.
+    uint8_t buffer[256];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t i = 0; i < n; ++i) Decode(&decoder, buffer[i]);
+    }
+
+    fprintf(stderr, "%u frames, %u bad frames\n", decoder.frames, decoder.badFrames);
+
+    if (decoder.telemetry) fclose(decoder.telemetry);
+    return decoder.frames ? 0 : 2;
+}
@@ -0,0 +1,196 @@
+/*
+ * Host-side replay benchmark for the GPS receive path.
+ *
+ * Replays a synthetic day of receiver output through the NMEA RMC parser and the UBX NAV-TIMEUTC parser, checks every
+ * decoded fix against the time that was encoded, and reports the bytes and time spent per fix. Bytes per fix is what
+ * matters on the PIC, since every byte costs an RX interrupt plus a parser step.
+ *
+ * Build and run from ClockController.X:
+ *     gcc -O2 -Wno-unknown-pragmas -I Host -o Host/gps_bench Host/gps_bench.c Host/xc.c gps.c ring_buffer.c bcd_utils.c ubx.c serial.c
+ *     Host/gps_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../gps.h"
+#include "../ubx.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define READ_CYCLES() __rdtsc()
+#else
+    #define READ_CYCLES() 0ull
+#endif
+
+#define SECONDS (24 * 60 * 60)
+
+struct Stream
+{
+    const char* name;
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+    void (*parse)(uint8_t data);
+};
+
+static void Append(struct Stream* stream, const void* data, size_t len)
+{
+    if (stream->len + len > stream->cap)
+    {
+        stream->cap = (stream->cap + len) * 2;
+        stream->data = realloc(stream->data, stream->cap);
+        if (!stream->data) abort();
+    }
+    
+    memcpy(stream->data + stream->len, data, len);
+    stream->len += len;
+}
+
+static void AppendNmea(struct Stream* stream, const char* body)
+{
+    uint8_t checksum = 0;
+    for (const char* c = body; *c; ++c) checksum ^= (uint8_t)*c;
+    
+    char sentence[128];
+    int len = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+    Append(stream, sentence, (size_t)len);
+}
+
+static void AppendRmc(struct Stream* stream, const struct DateTime* t)
+{
+    char body[96];
+    snprintf(body, sizeof(body), "GPRMC,%02u%02u%02u.00,A,4717.11437,N,00833.91522,E,0.004,77.52,%02u%02u%02u,,,A",
+        t->hour, t->minute, t->second, t->day, t->month, t->year);
+    AppendNmea(stream, body);
+}
+
+// The rest of the default NEO-6M output for one epoch.
+static void AppendOtherNmea(struct Stream* stream, const struct DateTime* t)
+{
+    char body[96];
+    
+    AppendNmea(stream, "GPVTG,77.52,T,,M,0.004,N,0.008,K,A");
+    snprintf(body, sizeof(body), "GPGGA,%02u%02u%02u.00,4717.11437,N,00833.91522,E,1,08,1.01,499.6,M,48.0,M,,",
+        t->hour, t->minute, t->second);
+    AppendNmea(stream, body);
+    AppendNmea(stream, "GPGSA,A,3,23,29,07,08,09,18,26,28,,,,,1.94,1.18,1.54");
+    AppendNmea(stream, "GPGSV,3,1,12,01,05,060,18,02,17,259,43,04,56,287,28,07,67,131,40");
+    AppendNmea(stream, "GPGSV,3,2,12,08,33,050,41,09,16,181,36,10,35,291,34,13,03,214,");
+    AppendNmea(stream, "GPGSV,3,3,12,17,09,327,15,18,24,082,43,26,55,064,46,28,38,238,38");
+    snprintf(body, sizeof(body), "GPGLL,4717.11437,N,00833.91522,E,%02u%02u%02u.00,A,A", t->hour, t->minute, t->second);
+    AppendNmea(stream, body);
+}
+
+static void AppendTimeUtc(struct Stream* stream, const struct DateTime* t)
+{
+    uint16_t year = 2000 + t->year;
+    uint8_t frame[6 + 20 + 2] = { UBX_SYNC_1, UBX_SYNC_2, UBX_CLASS_NAV, UBX_NAV_TIMEUTC, 20, 0 };
+    uint8_t* payload = frame + 6;
+    
+    payload[4] = 25; // tAcc
+    payload[12] = (uint8_t)year;
+    payload[13] = (uint8_t)(year >> 8);
+    payload[14] = t->month;
+    payload[15] = t->day;
+    payload[16] = t->hour;
+    payload[17] = t->minute;
+    payload[18] = t->second;
+    payload[19] = 0x07; // validTOW | validWKN | validUTC
+    
+    struct UbxChecksum checksum = { 0, 0 };
+    for (size_t i = 2; i < 6 + 20; ++i) UBX_UpdateChecksum(&checksum, frame[i]);
+    frame[26] = checksum.a;
+    frame[27] = checksum.b;
+    
+    Append(stream, frame, sizeof(frame));
+}
+
+static void Tick(struct DateTime* t)
+{
+    if (++t->second < 60) return;
+    t->second = 0;
+    if (++t->minute < 60) return;
+    t->minute = 0;
+    if (++t->hour < 24) return;
+    t->hour = 0;
+    ++t->day;
+}
+
+static void ParseNmea(uint8_t data) { GPS_ParseNmea((char)data); }
+
+static void Run(struct Stream* stream)
+{
+    struct DateTime expected = { 26, 10, 19, 0, 0, 0, 0 };
+    unsigned long fixes = 0;
+    unsigned long errors = 0;
+    
+    gGpsData.updated = 0;
+    
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long long startCycles = READ_CYCLES();
+    
+    for (size_t i = 0; i < stream->len; ++i)
+    {
+        stream->parse(stream->data[i]);
+        
+        if (gGpsData.updated)
+        {
+            gGpsData.updated = 0;
+            
+            if ((gGpsData.datetime.year != expected.year) || (gGpsData.datetime.month != expected.month) ||
+                (gGpsData.datetime.day != expected.day) || (gGpsData.datetime.hour != expected.hour) ||
+                (gGpsData.datetime.minute != expected.minute) || (gGpsData.datetime.second != expected.second) ||
+                (gGpsData.status != GPS_STATUS_VALID))
+            {
+                ++errors;
+            }
+            
+            ++fixes;
+            Tick(&expected);
+        }
+    }
+    
+    unsigned long long cycles = READ_CYCLES() - startCycles;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    
+    printf("%-16s %8lu %6lu %10.1f %10.1f %12.1f\n",
+        stream->name,
+        fixes,
+        errors,
+        fixes ? (double)stream->len / fixes : 0.0,
+        fixes ? ns / fixes : 0.0,
+        fixes ? (double)cycles / fixes : 0.0);
+}
+
+int main(void)
+{
+    struct Stream streams[] =
+    {
+        { "NMEA (default)", NULL, 0, 0, ParseNmea },
+        { "NMEA (RMC only)", NULL, 0, 0, ParseNmea },
+        { "UBX NAV-TIMEUTC", NULL, 0, 0, GPS_ParseUbx },
+    };
+    
+    struct DateTime t = { 26, 10, 19, 0, 0, 0, 0 };
+    for (int s = 0; s < SECONDS; ++s)
+    {
+        AppendRmc(&streams[0], &t);
+        AppendOtherNmea(&streams[0], &t);
+        
+        AppendRmc(&streams[1], &t);
+        
+        AppendTimeUtc(&streams[2], &t);
+        
+        Tick(&t);
+    }
+    
+    printf("%-16s %8s %6s %10s %10s %12s\n", "stream", "fixes", "errors", "bytes/fix", "ns/fix", "cycles/fix");
+    for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); ++i) Run(&streams[i]);
+    
+    return 0;
+}
@@ -0,0 +1,2 @@
+#define XC_SHIM_DEFINE
+#include "xc.h"
@@ -0,0 +1,68 @@
+#ifndef XC_H
+#define	XC_H
+
+/*
+ * Host-side stand-in for the XC8 device header. Registers are plain variables so firmware modules can be compiled and
+ * driven on Linux by the tools in this directory. Only the registers referenced by those modules are declared.
+ *
+ * xc.c defines the storage by including this file with XC_SHIM_DEFINE set.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __interrupt(...)
+#define __delay_ms(x) ((void)0)
+#define __delay_us(x) ((void)0)
+#define NOP() ((void)0)
+
+#ifdef XC_SHIM_DEFINE
+    #define REGISTER(type, name) volatile type name
+#else
+    #define REGISTER(type, name) extern volatile type name
+#endif
+
+#define REGISTER_BITS(name, ...) typedef struct { unsigned __VA_ARGS__; } name##_t; REGISTER(name##_t, name)
+
+REGISTER_BITS(INTCONbits, GIE:1, PEIE:1);
+REGISTER_BITS(PIE0bits, IOCIE:1, TMR0IE:1);
+REGISTER_BITS(PIR0bits, IOCIF:1, TMR0IF:1);
+REGISTER_BITS(PIE1bits, ADIE:1, BCL1IE:1, RC1IE:1, TX1IE:1, SSP1IE:1, TMR2IE:1, TMR1IE:1, CCP1IE:1);
+REGISTER_BITS(PIR1bits, ADIF:1, BCL1IF:1, RC1IF:1, TX1IF:1, SSP1IF:1, TMR2IF:1, TMR1IF:1, CCP1IF:1);
+REGISTER_BITS(ADACTbits, ACT:5);
+REGISTER_BITS(ADCON0bits, CHS:6, ON:1, GO:1);
+REGISTER_BITS(ADCON1bits, ADPREF:2, CS:3, FM:1);
+REGISTER_BITS(PWM3CONbits, EN:1, OUT:1, POL:1);
+REGISTER_BITS(RC1STAbits, CREN:1, FERR:1, OERR:1, SPEN:1);
+REGISTER_BITS(TX1STAbits, TXEN:1, TRMT:1, BRGH:1, SYNC:1);
+REGISTER_BITS(T2CONbits, CKPS:3, ON:1, OUTPS:4);
+REGISTER_BITS(T1CONbits, ON:1, RD16:1, nSYNC:1, CKPS:2);
+REGISTER_BITS(NVMCON1bits, RD:1, WR:1, WREN:1, WRERR:1, FREE:1, LWLO:1);
+
+REGISTER(uint8_t, ANSELA);
+REGISTER(uint8_t, ANSELC);
+REGISTER(uint8_t, TRISA);
+REGISTER(uint8_t, TRISC);
+REGISTER(uint8_t, FVRCON);
+REGISTER(uint16_t, ADRES);
+REGISTER(uint16_t, PWM3DC);
+REGISTER(uint8_t, RA2PPS);
+REGISTER(uint8_t, RC1REG);
+REGISTER(uint8_t, TX1REG);
+REGISTER(uint8_t, RC1STA);
+REGISTER(uint8_t, TX1STA);
+REGISTER(uint8_t, BAUD1CON);
+REGISTER(uint16_t, SP1BRG);
+REGISTER(uint8_t, T2CLKCON);
+REGISTER(uint8_t, T2PR);
+REGISTER(uint8_t, T2HLT);
+REGISTER(uint8_t, T2TMR);
+REGISTER(uint16_t, TMR1);
+REGISTER(uint8_t, T1CLK);
+REGISTER(uint8_t, NVMCON2);
+REGISTER(uint8_t, NVMREGS);
+REGISTER(uint16_t, NVMADR);
+REGISTER(uint16_t, NVMDAT);
+
+#endif	/* XC_H */
+
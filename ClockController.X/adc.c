@@ -4,6 +4,22 @@
 
 uint16_t gAdcCv = 0;
 
+static uint16_t gAdcAccumulator = 0;
+static uint8_t gAdcSamples = 0;
+
+// The filters hold their output scaled up by 2^shift: each update adds the input and takes away 1/2^shift of the
+// total. That keeps the arithmetic unsigned and loses no precision.
+static uint16_t gControlFilter = 0;
+static uint32_t gDisplayFilter = 0;
+
+#if ADC_DECIMATION_SHIFT > ADC_FRACTION_BITS
+#error The ADC sums have more fractional bits than the filters keep
+#endif
+
+#if ADC_FRACTION_BITS + ADC_CONTROL_FILTER_SHIFT > 6
+#error The control filter must fit 16 bits
+#endif
+
 void InitAdcPins(void)
 {
     // Set RC2 as an analog input for voltage monitoring
@@ -30,7 +46,7 @@ void InitAdc(void)
     // Select RC2 as the ADC channel (27.4.1)
     ADCON0bits.CHS = PPS_INPUT(PPS_PORT_C, 2); 
     
-    // Trigger acquisition with PWM3, which is driving the boost converter (27.4.3)
+    // Trigger acquisition with TMR2 post-scaled, which is also the PWM3 time base (27.4.3)
     ADACTbits.ACT = 0x4;
     
     // Enable the ADC (27.4.1)
@@ -41,6 +57,45 @@ void AdcInterruptHandler(void)
 {
     PIR1bits.ADIF = 0;
     
-    gAdcCv = ADRES;
+    uint16_t adc = ADRES;
+    
+    // React to over-voltage on the sample that shows it, rather than waiting out the filter. The control filter
+    // restarts from it so it doesn't remember the pre-trip voltage.
+    if (adc > ADC_HI_LIMIT)
+    {
+        gAdcAccumulator = 0;
+        gAdcSamples = 0;
+        
+        gAdcCv = ADC_TO_FILTERED(adc);
+        gControlFilter = gAdcCv << ADC_CONTROL_FILTER_SHIFT;
+        BoostConverter_Update(gAdcCv);
+        return;
+    }
+    
+    gAdcAccumulator += adc;
+    if (++gAdcSamples < ADC_DECIMATION) return;
+    
+    uint16_t sum = gAdcAccumulator << (ADC_FRACTION_BITS - ADC_DECIMATION_SHIFT);
+    gAdcAccumulator = 0;
+    gAdcSamples = 0;
+    
+    gControlFilter += sum - (gControlFilter >> ADC_CONTROL_FILTER_SHIFT);
+    gAdcCv = gControlFilter >> ADC_CONTROL_FILTER_SHIFT;
+    
+    gDisplayFilter += sum - (gDisplayFilter >> ADC_DISPLAY_FILTER_SHIFT);
+    
     BoostConverter_Update(gAdcCv);
 }
+
+uint16_t Adc_GetDisplayValue(void)
+{
+    // The filter is updated by the ISR, so read it atomically.
+    uint8_t gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    
+    uint32_t filter = gDisplayFilter;
+    
+    INTCONbits.GIE = gie;
+    
+    return (uint16_t)(filter >> ADC_DISPLAY_FILTER_SHIFT);
+}
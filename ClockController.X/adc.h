@@ -2,17 +2,39 @@
 #define	ADC_H
 
 #include <xc.h>
+#include "timer.h"
 
-extern uint16_t gAdcCv; ///< The current raw value of the ADC.
+// Conversions are triggered by the post-scaled TMR2 (TMR2_POST), then summed in groups of ADC_DECIMATION before
+// each boost converter update. Over-voltage samples skip the summing.
+#define ADC_DECIMATION_SHIFT 2 // [0-4]
+#define ADC_DECIMATION (1 << ADC_DECIMATION_SHIFT)
+#define ADC_SAMPLE_FREQ TMR2_INTERRUPT_FREQ
+#define ADC_UPDATE_FREQ (ADC_SAMPLE_FREQ / ADC_DECIMATION)
+
+// The sums are smoothed by two shift-based IIR filters, one for the control loop and a much slower one for display.
+// Each update moves a filter 1/2^shift of the way to the new sum. Both filtered values carry ADC_FRACTION_BITS bits
+// below the 10-bit ADC LSB.
+#define ADC_FRACTION_BITS 4
+#define ADC_CONTROL_FILTER_SHIFT 2 // [0-2]
+#define ADC_DISPLAY_FILTER_SHIFT 7 // ~64ms
+
+/// Converts a raw ADC value to the filtered scale.
+#define ADC_TO_FILTERED(adc) ((uint16_t)(adc) << ADC_FRACTION_BITS)
+
+extern uint16_t gAdcCv; ///< The value last given to the boost converter, with ADC_FRACTION_BITS fractional bits.
 
 ///
 /// Initializes the ADC.
 void InitAdc(void);
 
 ///
-/// Called by the ISR to process ADC interrupts.
+/// Called by the ISR to process ADC interrupts. Updates the boost converter every ADC_DECIMATION samples.
 void AdcInterruptHandler(void);
 
+///
+/// @returns The slowly filtered ADC value for display, with ADC_FRACTION_BITS fractional bits.
+uint16_t Adc_GetDisplayValue(void);
+
 ///
 /// Called to update the gAdcCv and gVoltage globals.
 void CaptureAdc(void);
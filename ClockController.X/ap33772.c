@@ -1,7 +1,7 @@
 #include "ap33772.h"
 #include "i2c.h"
-#include "clock.h"
-#include "oled.h"
+#include "timer.h"
+#include "rtc.h"
 
 static const uint8_t AP33772_ADDR = 0x51;
 
@@ -32,6 +32,13 @@ static const uint8_t AP33772_ADDR = 0x51;
 #define PDO_V_LSB 50
 #define PDO_A_LSB 10
 #define RDO_FIXED_A_LSB 10
+#define PPS_V_LSB 100
+#define PPS_A_LSB 50
+#define RDO_PPS_V_LSB 20
+#define RDO_PPS_A_LSB 50
+
+// Augmented PDO subtypes. Only the SPR PPS is supported.
+#define AP33772_PPS_TYPE_SPR 0
 
 struct AP33772_PowerDataObject
 {
@@ -95,6 +102,25 @@ struct AP33772_PowerDataObject pdos[AP33772_MaxPdoCount];
 uint8_t pdoCount = 0;
 uint8_t selectedPdo = 0;
 
+static struct AP33772_Status gStatus;
+static uint8_t gStatusValid = 0;
+static uint16_t gStatusReadTime;
+
+#ifndef AP33772_INT_ENABLED
+// The measurements when AP33772_GetStatus last read the status.
+static uint16_t gStatusVoltage;
+static uint16_t gStatusCurrent;
+#endif
+
+#ifdef AP33772_INT_ENABLED
+static volatile uint8_t gIntPending = 0;
+#endif
+
+static uint8_t gFaulted = 0;
+static uint16_t gFaultTime;
+static uint8_t gEventCount = 0;
+static struct AP33772_Event gLastEvent;
+
 union Status GetStatus(void)
 {
     uint8_t command = AP33772_CMD_STATUS;
@@ -105,6 +131,31 @@ union Status GetStatus(void)
     return status;
 }
 
+// Reading the status clears it, so every read goes through here to catch the protection events.
+static void ReadStatus(void)
+{
+    union Status status = GetStatus();
+    
+    gStatus.status = status;
+    gStatusReadTime = Timer_GetMillis();
+    
+    // No response
+    if (0xFF == status.raw) return;
+    
+    uint8_t events = status.raw & AP33772_STATUS_EVENTS;
+    if (!events) return;
+    
+    gLastEvent.status = events;
+    gLastEvent.time = gRtcDateTime;
+    if (gEventCount < UINT8_MAX) ++gEventCount;
+    
+    if (events & AP33772_STATUS_FAULTS)
+    {
+        gFaulted = 1;
+        gFaultTime = gStatusReadTime;
+    }
+}
+
 uint8_t IsReady(void)
 {
     union Status status = GetStatus();
@@ -123,100 +174,344 @@ void UpdatePDOs(void)
     else
     {
         command = AP33772_CMD_SRCPDO;
-        I2C_WriteRead(AP33772_ADDR, &command, sizeof(command), &pdos, sizeof(struct AP33772_PowerDataObject) * pdoCount);
+        I2C_WriteRead(AP33772_ADDR, &command, sizeof(command), &pdos,
+                sizeof(struct AP33772_PowerDataObject) * pdoCount);
     }
 }
 
 #define GetVoltage(pdo) ((pdo.raw[1] >> 2) | (((uint16_t)pdo.raw[2] & 0xF) << 6))
 #define GetAmperage(pdo) (pdo.raw[0] | (((uint16_t)pdo.raw[1] & 0x3) << 8))
 
-#define VOLTAGE 12
-#define PDO_RAW_VOLTAGE ((VOLTAGE * 1000) / PDO_V_LSB)
-#define RDO_CURRENT_OP (500 / RDO_FIXED_A_LSB)
-#define RDO_CURRENT_MAX (1000 / RDO_FIXED_A_LSB)
+#define GetPpsMinVoltage(pdo) (pdo.raw[1])
+#define GetPpsMaxVoltage(pdo) ((pdo.raw[2] >> 1) | ((pdo.raw[3] & 0x1) << 7))
+#define GetPpsAmperage(pdo) (pdo.raw[0] & 0x7F)
+#define GetPpsType(pdo) ((pdo.raw[3] >> 4) & 0x3)
+
+// The input the boost converter and the 78L05 are designed around. Lower inputs push the boost duty cycle against
+// PWM_DC_MAX, which keeps it in discontinuous conduction and so caps its power, and higher ones heat the 78L05. 12V
+// is also the least that regulates: in Host/boost_sim the rail sags 17.6V at 9V (7V at 11V) with all the tubes lit, so
+// nothing lower is asked for, whatever power it offers.
+#define PD_PREFERRED_MV 12000
+#define PD_MIN_MV PD_PREFERRED_MV
+#define PD_MAX_MV 15000
+
+// The input power with all the tubes lit, and the margin asked for on top of it.
+#define PD_LOAD_MW 5000
+#define PD_NEEDED_MW (PD_LOAD_MW + PD_LOAD_MW / 2)
+
+// Scores for SelectPDO. PDOs without the margin rank after all of those with it.
+#define SCORE_LOW_POWER 0x1000
+#define SCORE_UNUSABLE 0xFFFF
+
+// A PPS contract lapses unless the request is repeated within 10s (tPPSRequest).
+#define PPS_REFRESH_MS 8000
 
-uint8_t SelectPDO(void)
+static uint8_t gRdo[5] = { AP33772_CMD_RDO, 0, 0, 0, 0 };
+static uint8_t gPps = 0;
+static uint16_t gRdoTime;
+static uint16_t gSelectedMv = 0;
+static uint16_t gSelectedMa = 0;
+static uint8_t gPdosTried = 0;
+static uint8_t gLowPower = 0;
+
+#define NEGOTIATE_STATE_WAIT_READY 0
+#define NEGOTIATE_STATE_READ_PDOS 1
+#define NEGOTIATE_STATE_WAIT_ACCEPT 2
+#define NEGOTIATE_STATE_DONE 3
+#define NEGOTIATE_STATE_FAILED 4
+
+static uint8_t gNegotiateState = NEGOTIATE_STATE_WAIT_READY;
+static uint8_t gWaitCounter = 0;
+
+// Gets the voltage to ask a PDO for and the most current it offers at it. PPS ranges are asked for the voltage nearest
+// PD_PREFERRED_MV.
+static uint8_t GetOffer(uint8_t index, uint16_t* mv, uint16_t* ma)
 {
-    // Find a fixed PDO with the desired voltage
-    while (selectedPdo < pdoCount)
-    {        
-        if ((AP33772_PDO_TYPE_FIXED == pdos[selectedPdo].any.type) && 
-                (GetVoltage(pdos[selectedPdo]) == PDO_RAW_VOLTAGE)) break;
-        ++selectedPdo;
+    if (AP33772_PDO_TYPE_FIXED == pdos[index].any.type)
+    {
+        *mv = GetVoltage(pdos[index]) * PDO_V_LSB;
+        *ma = GetAmperage(pdos[index]) * PDO_A_LSB;
+        return 1;
     }
     
-    if (selectedPdo >= pdoCount)
+    if (AP33772_PDO_TYPE_AUG == pdos[index].any.type && AP33772_PPS_TYPE_SPR == GetPpsType(pdos[index]))
     {
-        OLED_DrawString(3, 2, "Inadequate power!", 0);
-        return 0;
+        uint16_t minMv = GetPpsMinVoltage(pdos[index]) * PPS_V_LSB;
+        uint16_t maxMv = GetPpsMaxVoltage(pdos[index]) * PPS_V_LSB;
+        
+        *mv = PD_PREFERRED_MV;
+        if (*mv < minMv) *mv = minMv;
+        if (*mv > maxMv) *mv = maxMv;
+        
+        *ma = GetPpsAmperage(pdos[index]) * PPS_A_LSB;
+        return 1;
     }
     
-    uint8_t rdo[5] = { AP33772_CMD_RDO, 0, 0, 0, 0 };
+    return 0;
+}
+
+// Lower is better, and nearer PD_PREFERRED_MV scores lower. Among PDOs short of PD_NEEDED_MW, the one offering the
+// most power ranks first.
+static uint16_t Score(uint16_t mv, uint16_t ma)
+{
+    if (mv < PD_MIN_MV || mv > PD_MAX_MV) return SCORE_UNUSABLE;
+    
+    uint16_t score = (mv - PD_MIN_MV) / 100;
     
-    rdo[1] = RDO_CURRENT_MAX & 0xFF;
-    rdo[2] = ((RDO_CURRENT_MAX >> 8) & 0x3) | (RDO_CURRENT_OP << 2);
-    rdo[3] = RDO_CURRENT_OP >> 6;
-    rdo[4] = ((selectedPdo + 1) << 4) & 0x70; // PDO positions are 1-indexed in the protocol
+    uint32_t mw = ((uint32_t)mv * ma) / 1000;
+    if (mw < PD_NEEDED_MW) score += SCORE_LOW_POWER + (uint16_t)(PD_NEEDED_MW - mw) / 8;
     
-    I2C_Write(AP33772_ADDR, &rdo, sizeof(rdo));
+    return score;
+}
+
+// Asks for the offer from GetOffer. The operating current is what the load needs, or all there is.
+static void RequestPDO(uint8_t index, uint16_t mv, uint16_t ma)
+{
+    uint16_t operatingMa = (uint16_t)(((uint32_t)PD_LOAD_MW * 1000) / mv);
+    if (operatingMa > ma) operatingMa = ma;
     
-    union Status status = { 0 };
-    while (!status.ready)
+    uint32_t rdo = (uint32_t)(index + 1) << 28; // PDO positions are 1-indexed in the protocol
+    
+    gPps = AP33772_PDO_TYPE_AUG == pdos[index].any.type;
+    if (gPps)
+    {
+        // The source limits the current to the operating current in PPS, so ask for all of it.
+        rdo |= ((uint32_t)(mv / RDO_PPS_V_LSB) << 9) | (ma / RDO_PPS_A_LSB);
+    }
+    else
     {
-        __delay_ms(10);
-        status = GetStatus();
+        rdo |= ((uint32_t)(operatingMa / RDO_FIXED_A_LSB) << 10) | (ma / RDO_FIXED_A_LSB);
     }
     
-    return status.success;
+    gRdo[1] = (uint8_t)rdo;
+    gRdo[2] = (uint8_t)(rdo >> 8);
+    gRdo[3] = (uint8_t)(rdo >> 16);
+    gRdo[4] = (uint8_t)(rdo >> 24);
+    
+    I2C_Write(AP33772_ADDR, &gRdo, sizeof(gRdo));
+    gRdoTime = Timer_GetMillis();
 }
 
-uint8_t AP33772_Init(void)
+// Requests the best PDO not tried yet.
+//
+// @returns 0 if there are none left.
+static uint8_t SelectPDO(void)
 {
-    OLED_DrawString(0, 0, "Waiting for USB PD...", 1);
-    
-    uint8_t waitCounter = 0;
+    uint16_t bestScore = SCORE_UNUSABLE;
+    uint16_t bestMv = 0, bestMa = 0;
     
-    // Wait for the AP33772 to bootstrap
-    while (!IsReady())
+    for (uint8_t i = 0; i < pdoCount; ++i)
     {
-        // If we've waited 1+ seconds, reset the AP33772
-        if (waitCounter++ > 99)
+        uint16_t mv, ma;
+        if ((gPdosTried & (1 << i)) || !GetOffer(i, &mv, &ma)) continue;
+        
+        uint16_t score = Score(mv, ma);
+        
+        // On a tie, the one with more current to spare
+        if (score < bestScore || (score == bestScore && SCORE_UNUSABLE != score && ma > bestMa))
         {
-            waitCounter = 0;
-            
-            uint8_t buffer[5] = { AP33772_CMD_RDO, 0, 0, 0, 0 };
-            I2C_Write(AP33772_ADDR, &buffer, sizeof(buffer));
+            bestScore = score;
+            bestMv = mv;
+            bestMa = ma;
+            selectedPdo = i;
         }
-        
-        __delay_ms(10);
     }
     
-    OLED_DrawString(1, 0, "  Waiting for PDOs...", 1);
+    if (SCORE_UNUSABLE == bestScore) return 0;
+    
+    gPdosTried |= 1 << selectedPdo;
+    gSelectedMv = bestMv;
+    gSelectedMa = bestMa;
+    
+    // The tubes may brown out the supply, but the clock runs.
+    gLowPower = bestScore >= SCORE_LOW_POWER;
+    
+    RequestPDO(selectedPdo, bestMv, bestMa);
+    return 1;
+}
+
+#ifdef AP33772_INT_ENABLED
+static void EnableInterrupt(void)
+{
+    // RA3 is an input only, interrupting on the rising edge as INT asserts (17.3)
+    IOCAP |= AP33772_INT_PIN_MASK;
+    
+    // The mask register matches the status bits. Only the protection events assert INT.
+    uint8_t mask[] = { AP33772_CMD_MASK, AP33772_STATUS_EVENTS };
+    I2C_Write(AP33772_ADDR, mask, sizeof(mask));
+    
+    // Clear what was latched while negotiating, which may already have asserted INT.
+    ReadStatus();
+    IOCAF &= ~AP33772_INT_PIN_MASK;
+}
+#endif
 
-    while (pdoCount == 0)
+uint8_t AP33772_Negotiate(void)
+{
+    switch (gNegotiateState)
     {
-        UpdatePDOs();
-        __delay_ms(10);
+        case NEGOTIATE_STATE_WAIT_READY:
+            // Wait for the AP33772 to bootstrap
+            if (IsReady())
+            {
+                gNegotiateState = NEGOTIATE_STATE_READ_PDOS;
+            }
+            else if (gWaitCounter++ > 99)
+            {
+                // If we've waited 1+ seconds, reset the AP33772
+                gWaitCounter = 0;
+                
+                uint8_t buffer[5] = { AP33772_CMD_RDO, 0, 0, 0, 0 };
+                I2C_Write(AP33772_ADDR, &buffer, sizeof(buffer));
+            }
+            break;
+            
+        case NEGOTIATE_STATE_READ_PDOS:
+            UpdatePDOs();
+            if (!pdoCount) break;
+            
+            // Try the PDOs best first, falling back to the next if the source rejects one.
+            gPdosTried = 0;
+            gNegotiateState = SelectPDO() ? NEGOTIATE_STATE_WAIT_ACCEPT : NEGOTIATE_STATE_FAILED;
+            break;
+            
+        case NEGOTIATE_STATE_WAIT_ACCEPT:
+        {
+            union Status status = GetStatus();
+            if (!status.ready) break;
+            
+            if (status.success)
+            {
+#ifdef AP33772_INT_ENABLED
+                EnableInterrupt();
+#endif
+                gNegotiateState = NEGOTIATE_STATE_DONE;
+            }
+            else if (!SelectPDO())
+            {
+                gNegotiateState = NEGOTIATE_STATE_FAILED;
+            }
+            break;
+        }
     }
     
-    return SelectPDO();
+    if (NEGOTIATE_STATE_DONE == gNegotiateState) return AP33772_NEGOTIATE_DONE;
+    if (NEGOTIATE_STATE_FAILED == gNegotiateState) return AP33772_NEGOTIATE_FAILED;
+    return AP33772_NEGOTIATE_BUSY;
+}
+
+uint8_t AP33772_LowPower(void)
+{
+    return gLowPower;
+}
+
+#ifndef AP33772_INT_ENABLED
+static uint8_t Moved(uint16_t value, uint16_t reference, uint16_t delta)
+{
+    return value > reference + delta || value + delta < reference;
 }
+#endif
 
 void AP33772_GetStatus(struct AP33772_Status* buffer)
 {
-    uint8_t command = AP33772_CMD_CURRENT;
-    uint8_t rawCurrent = 0;
-    I2C_WriteRead(AP33772_ADDR, &command, sizeof(command), &rawCurrent, sizeof(rawCurrent));
+    // Reading the status during the negotiation would clear the bits it waits on.
+    if (NEGOTIATE_STATE_DONE != gNegotiateState)
+    {
+        *buffer = gStatus;
+        return;
+    }
+    
+    if (!gStatusValid || Timer_MillisSince(gStatus.timestamp) >= AP33772_MAX_AGE_MS)
+    {
+        // VOLTAGE, CURRENT and TEMP are consecutive, and the register address increments through a read.
+        uint8_t command = AP33772_CMD_VOLTAGE;
+        uint8_t raw[3] = { 0, 0, 0 };
+        I2C_WriteRead(AP33772_ADDR, &command, sizeof(command), &raw, sizeof(raw));
+        
+        uint16_t voltage = (uint16_t)raw[0] * REG_V_LSB;
+        uint16_t current = (uint16_t)raw[1] * REG_A_LSB;
+        uint16_t now = Timer_GetMillis();
+        
+        uint8_t readStatus = !gStatusValid || Timer_MillisSince(gStatusReadTime) >= AP33772_STATUS_POLL_MS;
+        
+#ifndef AP33772_INT_ENABLED
+        // INT reports the events as they happen. Without it, a large move in the measurements is the early sign.
+        if (Moved(voltage, gStatusVoltage, AP33772_STATUS_DELTA_MV) || Moved(current, gStatusCurrent,
+                AP33772_STATUS_DELTA_MA))
+        {
+            readStatus = 1;
+        }
+        
+        if (readStatus)
+        {
+            gStatusVoltage = voltage;
+            gStatusCurrent = current;
+        }
+#endif
+        
+        if (readStatus) ReadStatus();
+        
+        gStatus.voltage = voltage;
+        gStatus.current = current;
+        gStatus.temperature = raw[2];
+        gStatus.timestamp = now;
+        
+        gStatus.selectedPdoPos = selectedPdo + 1;
+        gStatus.pdoMaxAmps = (uint8_t)(gSelectedMa / 1000);
+        gStatus.pdoMaxVolts = (uint8_t)(gSelectedMv / 1000);
+        
+        gStatusValid = 1;
+    }
+    
+    *buffer = gStatus;
+}
 
-    command = AP33772_CMD_VOLTAGE;
-    uint8_t rawVoltage = 0;
-    I2C_WriteRead(AP33772_ADDR, &command, sizeof(command), &rawVoltage, sizeof(rawVoltage));
+void AP33772_HandleInterrupt(void)
+{
+#ifdef AP33772_INT_ENABLED
+    IOCAF &= ~AP33772_INT_PIN_MASK;
+    gIntPending = 1;
+#endif
+}
 
-    buffer->status.raw = GetStatus().raw;
-    buffer->current = (uint16_t)rawCurrent * REG_A_LSB;
-    buffer->voltage = (uint16_t)rawVoltage * REG_V_LSB;
+void AP33772_Task(void)
+{
+#ifdef AP33772_INT_ENABLED
+    if (gIntPending)
+    {
+        gIntPending = 0;
+        ReadStatus();
+    }
+#else
+    // The protection events would otherwise only be seen while something shows the status. Reading it during the
+    // negotiation would clear the bits it waits on.
+    if (NEGOTIATE_STATE_DONE == gNegotiateState && Timer_MillisSince(gStatusReadTime) >= AP33772_STATUS_POLL_MS)
+    {
+        ReadStatus();
+    }
+#endif
     
-    buffer->selectedPdoPos = selectedPdo;
-    buffer->pdoMaxAmps = (uint8_t)(GetAmperage(pdos[selectedPdo]) / (1000 / PDO_A_LSB));
-    buffer->pdoMaxVolts = (uint8_t)(GetVoltage(pdos[selectedPdo]) / (1000 / PDO_V_LSB));
-}
\ No newline at end of file
+    if (gPps && Timer_MillisSince(gRdoTime) >= PPS_REFRESH_MS)
+    {
+        I2C_Write(AP33772_ADDR, &gRdo, sizeof(gRdo));
+        gRdoTime = Timer_GetMillis();
+    }
+    
+    // A fault that's still there is reported again, restarting the hold.
+    if (gFaulted && Timer_MillisSince(gFaultTime) >= AP33772_FAULT_HOLD_MS)
+    {
+        gFaulted = 0;
+        ReadStatus();
+    }
+}
+
+uint8_t AP33772_Faulted(void)
+{
+    return gFaulted;
+}
+
+uint8_t AP33772_GetLastEvent(struct AP33772_Event* event)
+{
+    if (gEventCount) *event = gLastEvent;
+    return gEventCount;
+}
@@ -3,6 +3,46 @@
 
 #include <xc.h>
 
+#include "time_utils.h"
+
+// Defining this macro takes the AP33772 protection events from its INT pin, wired to RA3, as they happen. Without it
+// AP33772_Task polls the status every AP33772_STATUS_POLL_MS. RA3 is the MCLR pin, so this also turns off
+// low-voltage programming (see config_bits.h), and the PIC has to be programmed with high voltage on MCLR.
+//#define AP33772_INT_ENABLED
+
+// The INT pin, RA3
+#define AP33772_INT_PIN_MASK 0x08
+
+// Callers within this age of the last read share it.
+#define AP33772_MAX_AGE_MS 100
+
+// The longest the status register goes unread.
+#define AP33772_STATUS_POLL_MS 1000
+
+// Without AP33772_INT_ENABLED, the status register is also read when the measurements move by more than these from
+// where they were at the last status read. The boost input current follows every tube fade, so small changes don't
+// count. A protection event moves them much further.
+#define AP33772_STATUS_DELTA_MV 500
+#define AP33772_STATUS_DELTA_MA 250
+
+// The status bits that report a protection event. OVP, OCP and OTP blank the tubes, which sheds the boost load, until
+// they have been clear for AP33772_FAULT_HOLD_MS. Derating is only logged; the tubes have no brightness control.
+#define AP33772_STATUS_OVP 0x10
+#define AP33772_STATUS_OCP 0x20
+#define AP33772_STATUS_OTP 0x40
+#define AP33772_STATUS_DERATING 0x80
+#define AP33772_STATUS_FAULTS (AP33772_STATUS_OVP | AP33772_STATUS_OCP | AP33772_STATUS_OTP)
+#define AP33772_STATUS_EVENTS (AP33772_STATUS_FAULTS | AP33772_STATUS_DERATING)
+
+// While faulted, the status is read again this often. A fault that persists is reported again.
+#define AP33772_FAULT_HOLD_MS 5000
+
+#define AP33772_NEGOTIATE_PERIOD 10
+
+#define AP33772_NEGOTIATE_BUSY 0
+#define AP33772_NEGOTIATE_DONE 1
+#define AP33772_NEGOTIATE_FAILED 2 ///< No PDO was usable, or the source rejected them all.
+
 union Status
 {
     uint8_t raw; ///< The full status byte.
@@ -25,20 +65,62 @@ struct AP33772_Status
     union Status status; ///< The status bits.
     uint16_t current; ///< In mA
     uint16_t voltage; ///< in mV
+    uint8_t temperature; ///< In C
+    uint16_t timestamp; ///< The Timer_GetMillis() tick when the measurements were read.
     
     uint8_t selectedPdoPos; ///< The position of the selected PDO (1-indexed).
     uint8_t pdoMaxAmps; ///< In Amps
     uint8_t pdoMaxVolts; ///< In Volts
 } AP33772_StatusAndPower;
 
-/// Initializes the AP337772 USB PD client.
+struct AP33772_Event
+{
+    uint8_t status; ///< The AP33772_STATUS_EVENTS bits that were set.
+    struct DateTime time; ///< The local time, from the RTC.
+};
+
+/// Advances the USB PD negotiation without blocking: waits for the AP33772 to start (resetting it every second), reads
+/// the source PDOs, and requests one. Call every AP33772_NEGOTIATE_PERIOD ms until it's done or has failed.
 ///
-/// @result A PDO will be selected from the PD host, powering the system.
-/// @remark Status messages will be displayed while initializing and on error.
-/// @return 1 on success, 0 if an error is encountered.
-uint8_t AP33772_Init(void);
+/// @result A PDO will be selected from the PD host, powering the system. Fixed and PPS PDOs from 12V to 15V are ranked
+///         by closeness to 12V and by power to spare, and the next best is tried if the host rejects one. Lower
+///         voltages can't hold the HV rail up, so a source without 12V-15V fails the negotiation.
+/// @return One of the AP33772_NEGOTIATE_XXX values.
+uint8_t AP33772_Negotiate(void);
 
+///
+/// @returns 1 if the negotiated PDO can't supply the expected load with margin to spare.
+uint8_t AP33772_LowPower(void);
+
+/// Gets the status and measurements, read at most AP33772_MAX_AGE_MS ago.
+///
+/// The voltage, current and temperature are read in one transfer when the cached values are too old. The status
+/// register is read every AP33772_STATUS_POLL_MS, or sooner if the measurements have moved (see
+/// AP33772_STATUS_DELTA_MV).
+///
+/// @param buffer Receives a copy of the cached status.
 void AP33772_GetStatus(struct AP33772_Status* buffer);
 
+///
+/// Called by the ISR to process IOC interrupts on the INT pin.
+void AP33772_HandleInterrupt(void);
+
+///
+/// Reads the status after an interrupt (or every AP33772_STATUS_POLL_MS without AP33772_INT_ENABLED), and while
+/// faulted, to log protection events and to end the fault. Repeats the request for a PPS PDO to keep the contract
+/// alive. Called every few ms.
+void AP33772_Task(void);
+
+/// Checks for a protection fault.
+///
+/// @returns 1 if any of AP33772_STATUS_FAULTS was reported in the last AP33772_FAULT_HOLD_MS.
+uint8_t AP33772_Faulted(void);
+
+/// Gets the last protection event.
+///
+/// @param event Receives the event. Left unchanged if there haven't been any.
+/// @returns The number of events since reset, saturating at 255.
+uint8_t AP33772_GetLastEvent(struct AP33772_Event* event);
+
 #endif	/* AP33772_H */
 
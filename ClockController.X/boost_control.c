@@ -2,76 +2,262 @@
 #include "timer.h"
 #include "pwm.h"
 #include "adc.h"
+#include "nvm.h"
+#include "telemetry.h"
 
 #include <xc.h>
 
-#ifndef SKIP_PD
-    // This defines the maximum allowed voltage (~200V).
-    #define ADC_HI_LIMIT 787L
-#else
-    // ~12V if we're in debug and running off the PICKit.
-    #define ADC_HI_LIMIT 47L
-#endif
-
 // The ADC returns a 10-bit value dividing the range 0mv to 4096mV evenly so mV/4 = ADC.
 // The expected voltage from the voltage divider is ~2,835mV, which means the expected ADC value is ~709. This will
 // vary with the exact resistance of the resistors in the voltage divider.
+// These are used until the board has been calibrated.
 #define ADC_SP 721L
+#define ADC_SP_FILTERED ADC_TO_FILTERED(ADC_SP)
 #define ADC_DEADBAND 5
 
+// The calibration maps a filtered ADC value to volts as (cv * gain >> CAL_SHIFT) + offset. The gain is in volts per
+// ADC count with CAL_GAIN_BITS fractional bits, and the offset in volts with CAL_OFFSET_BITS. Both are stored in the
+// 14-bit NVM words, which limits the gain to ~0.5V per count and the offset to +/-128V.
+#define CAL_GAIN_BITS 15
+#define CAL_OFFSET_BITS 6
+#define CAL_SHIFT (CAL_GAIN_BITS + ADC_FRACTION_BITS - CAL_OFFSET_BITS)
+
+// Uncalibrated, the display uses the nominal divider ratio.
+#define CAL_GAIN_DEFAULT (uint16_t)((1.0 / 4 - 1.0 / 330) * (1L << CAL_GAIN_BITS))
+
+// Anything outside these isn't the divider on this board: the points were mistyped, or the NVM is blank.
+#define CAL_GAIN_MIN (1 << (CAL_GAIN_BITS - 3))
+#define CAL_GAIN_MAX (NVM_EMPTY - 1)
+#define CAL_OFFSET_MAX 0x1FFF
+
+// The calibration points must be at least this far apart (0.1V).
+#define CAL_MIN_SPAN 200
+
+// The span is shifted by CAL_SHIFT + CAL_OFFSET_BITS in 32 bits to compute the gain, so wider ones overflow.
+#define CAL_MAX_SPAN (UINT32_MAX >> (CAL_SHIFT + CAL_OFFSET_BITS))
+
 // The voltage booster is controlled by changing the duty-cycle (DC) of the PWM signal driving it.
 // By scaling the working DC value, we can have a working value with more granularity than the actual PWM allows. This
 // can allow for some smoother control, depending on the algorithm.
 #define PWM_DC_SCALAR 0x20
 #define PWM_DC_100 ((TMR2_RESET << 2) * PWM_DC_SCALAR)
-#define PWM_DC_MAX (uint16_t)(0.95 * PWM_DC_100)
+
+// The inductor only discharges fully each period while D < (Vout - Vin) / Vout, ~93% for 180V from 12V. Past that it
+// runs into continuous conduction and the current ratchets up each period until OVP trips, so the duty cycle stays
+// below it. That is also the most power the converter can deliver, which from 12V is ~12 lit cathodes.
+#define PWM_DC_MAX (uint16_t)(0.92 * PWM_DC_100)
+
+#define PWM_DC_MIN 0
+
+// Defining this macro selects the original +/-1 LSB stepper instead of the PI controller. It's kept for comparison
+// (see Host/boost_sim.c).
+//#define BOOST_CONTROL_STEPPER
+
+#ifdef BOOST_CONTROL_STEPPER
+
+// The step limits below were tuned with an update on every conversion at 32 kHz. They're scaled by the update period
+// so the duty cycle slews at the same rate whatever the decimation.
+#define DPWMDC_REFERENCE_FREQ (32 * 1000ul)
+#define DPWMDC_SCALE (DPWMDC_REFERENCE_FREQ / ADC_UPDATE_FREQ)
+
+#if DPWMDC_SCALE < 1
+#error The boost converter update rate is too high for the step limits
+#endif
 
 // Control constants when over SP
 #define PID_P_NUM_HI 1
 #define PID_P_DENOM_HI 1
-#define PID_DPWMDC_MAX_HI 0x1
+#define PID_DPWMDC_MAX_HI (0x1 * DPWMDC_SCALE)
 
 // Control constants when below SP
 #define PID_P_NUM_LO 1
 #define PID_P_DENOM_LO 2
-#define PID_DPWMDC_MAX_LO 0x1
+#define PID_DPWMDC_MAX_LO (0x1 * DPWMDC_SCALE)
+
+#else
+
+// PI gains, as powers of two so the update is shifts and adds. The output is in scaled DC units (1/PWM_DC_SCALAR of a
+// PWM count) and the error in filtered ADC counts (ADC_FRACTION_BITS fractional bits).
+//   P: 2^PI_KP_SHIFT / 2^PI_I_FRACTION units per count
+//   I: 2^PI_KI_SHIFT / 2^PI_I_FRACTION units per count, per update
+// The P term is summed with the integrator before dropping the fraction, so both gains can be below 1.
+// They were tuned against the model in Host/boost_sim.c.
+#define PI_KP_SHIFT 12
+#define PI_KI_SHIFT 4
+#define PI_I_FRACTION 8
+
+// Largest change of the output in one update, in scaled DC units (~50%). This limits how hard noise or a large error
+// can kick the converter, but lets a fed-forward load step through within a couple of updates: PWM_DC_MAX already
+// bounds the input current.
+#define PI_SLEW_MAX (PWM_DC_SCALAR * 256)
+
+// The integrator, in scaled DC units with PI_I_FRACTION fractional bits.
+static int32_t gIntegrator;
+
+#endif
+
+// Feedforward: the duty cycle the converter settles at for each whole number of lit cathodes, in %, from 12V. In
+// discontinuous conduction the power delivered goes as the square of the duty cycle, D = sqrt(2 L f P) / Vin, and a
+// lit cathode takes ~0.37W at 180V, with the divider worth another ~0.1 of one. The step between 0 and 1 cathode is
+// ~19% and that between 11 and 12 only ~4%, so a single gain is too much for one end or too little for the other.
+// Changes in the expected load move the duty cycle by the difference, interpolated between whole cathodes.
+#define FF_DUTY(pct) (uint16_t)((pct) * PWM_DC_100 / 100)
+#define FF_CATHODES 12
+#define FF_LOAD_PER_CATHODE 16
+
+static const uint16_t FF_DUTY_TABLE[FF_CATHODES + 1] =
+{
+    FF_DUTY(8.3), FF_DUTY(27.6), FF_DUTY(38.1), FF_DUTY(46.3), FF_DUTY(53.3), FF_DUTY(59.4), FF_DUTY(65.0),
+    FF_DUTY(70.1), FF_DUTY(74.9), FF_DUTY(79.3), FF_DUTY(83.6), FF_DUTY(87.6), FF_DUTY(91.5)
+};
 
-static uint16_t gPwmDutyCycle = (uint16_t)(0.8 * PWM_DC_100);
+// Soft-start: the setpoint ramps from the voltage at power-up to the target over SOFT_START_MS, and the loop follows
+// it. Charging the output capacitor over this time keeps the input current within the PD contract, and the loop never
+// has a large error to overshoot from. The setpoint is held within SOFT_START_LEAD (~8V) of the output, so if the
+// converter can't keep up the ramp waits for it rather than winding up the integrator.
+#define SOFT_START_MS 30
+#define SOFT_START_STEP (uint16_t)(ADC_SP_FILTERED / (SOFT_START_MS * ADC_UPDATE_FREQ / 1000))
+#define SOFT_START_LEAD ADC_TO_FILTERED(32)
+
+// Calibration targets are approached the same way.
+//
+// HV is ready once the setpoint has reached the target and the voltage has stayed within HV_READY_BAND (~2V) of it for
+// HV_READY_UPDATES (~10ms).
+#define HV_READY_BAND ADC_TO_FILTERED(8)
+#define HV_READY_UPDATES (uint8_t)(10 * ADC_UPDATE_FREQ / 1000)
+
+static uint16_t gPwmDutyCycle = PWM_DC_MIN;
 static uint8_t gOverVoltageProtection = 0;
 
-void BoostConverter_Init(void)
+// The regulation target and OVP limit, in filtered ADC units. These come from the calibration; gTarget is moved to the
+// calibration points while they're measured.
+static uint16_t gRegulationTarget = ADC_SP_FILTERED;
+static volatile uint16_t gTarget = ADC_SP_FILTERED;
+static volatile uint16_t gHiLimit = ADC_TO_FILTERED(ADC_HI_LIMIT);
+
+static uint16_t gCalGain = CAL_GAIN_DEFAULT;
+static int16_t gCalOffset = 0;
+
+struct CalibrationPoint
 {
-    SetPwmDutyCycle(gPwmDutyCycle);
+    uint16_t cv;
+    uint16_t decivolts;
+};
+
+static struct CalibrationPoint gCalPoints[2];
+
+// The soft-start setpoint; 0 until the first update.
+static uint16_t gSetpoint = 0;
+static uint8_t gReadyCount = 0;
+static volatile uint8_t gHvReady = 0;
+
+// Once HV is ready, the tubes are blanked while the output is outside HV_MIN-HV_MAX (around the setpoint, so a
+// calibration point doesn't count). They're restored once it has been back inside for HV_RESTORE_UPDATES (~50ms).
+#define HV_RESTORE_UPDATES (uint8_t)(50 * ADC_UPDATE_FREQ / 1000)
+
+// HV_DEADBAND in filtered ADC units, from the calibration.
+static uint16_t gDeadband;
+
+static volatile uint8_t gHvInRange = 1;
+static uint8_t gRestoreCount = 0;
+static uint16_t gExcursionUpdates = 0;
+
+// Excursions outside the range: the number, and the last and longest durations in ms.
+static volatile uint16_t gExcursionCount = 0;
+static volatile uint16_t gLastExcursion = 0;
+static volatile uint16_t gLongestExcursion = 0;
+
+static volatile uint8_t gExpectedLoad = 0;
+static uint8_t gAppliedLoad = 0;
+
+// The expected duty cycle for a load, in scaled DC units.
+static uint16_t FeedForwardDuty(uint8_t load)
+{
+    uint8_t cathodes = load / FF_LOAD_PER_CATHODE;
+    if (cathodes >= FF_CATHODES) return FF_DUTY_TABLE[FF_CATHODES];
+    
+    uint16_t step = FF_DUTY_TABLE[cathodes + 1] - FF_DUTY_TABLE[cathodes];
+    
+    return FF_DUTY_TABLE[cathodes] + step * (load % FF_LOAD_PER_CATHODE) / FF_LOAD_PER_CATHODE;
 }
 
-void BoostConverter_Update(uint16_t adc)
+static uint16_t VoltsToAdc(uint8_t volts)
 {
-#ifdef SKIP_PD
-    return;
-#endif
+    int32_t v = ((int32_t)volts << CAL_OFFSET_BITS) - gCalOffset;
+    if (v < 0) return 0;
     
-    // If save voltage levels are exceeded, stop the PWM.
-    if (adc > ADC_HI_LIMIT)
-    {
-        PWM_Disable();
-        gOverVoltageProtection = 1;
-        
-        return;
-    }
+    uint32_t cv = ((uint32_t)v << CAL_SHIFT) / gCalGain;
+    if (cv > ADC_TO_FILTERED(1023)) cv = ADC_TO_FILTERED(1023);
     
-    // While in OVP, wait for voltage to drop back to a save level before halving the PWM DC and restarting.
-    if (gOverVoltageProtection)
+    return (uint16_t)cv;
+}
+
+// The voltage for a filtered ADC value, with CAL_OFFSET_BITS fractional bits.
+static int32_t AdcToVolts(uint16_t cv)
+{
+    return (int32_t)(((uint32_t)cv * gCalGain) >> CAL_SHIFT) + gCalOffset;
+}
+
+static void SetTargets(uint16_t target, uint16_t hiLimit)
+{
+    uint16_t deadband = (uint16_t)(((uint32_t)HV_DEADBAND << (CAL_SHIFT + CAL_OFFSET_BITS)) / gCalGain);
+    
+    // These are read by the ADC interrupt.
+    INTCONbits.GIE = 0;
+    gTarget = target;
+    gHiLimit = hiLimit;
+    gDeadband = deadband;
+    INTCONbits.GIE = 1;
+}
+
+static void LoadCalibration(void)
+{
+    uint16_t gain = Nvm_Read(NVM_WORD_HV_GAIN);
+    uint16_t offset = Nvm_Read(NVM_WORD_HV_OFFSET);
+    
+    // Without a calibration, keep the hand-tuned ADC values.
+    if (gain < CAL_GAIN_MIN || gain > CAL_GAIN_MAX)
     {
-        if (adc > ADC_SP) return;
-        
-        gPwmDutyCycle /= 2;
-        PWM_Enable(gPwmDutyCycle / PWM_DC_SCALAR);
+        gCalGain = CAL_GAIN_DEFAULT;
+        gCalOffset = 0;
+        gRegulationTarget = ADC_SP_FILTERED;
+        SetTargets(gRegulationTarget, ADC_TO_FILTERED(ADC_HI_LIMIT));
         
-        gOverVoltageProtection = 0;
         return;
     }
     
-    int16_t cvError = (int16_t)adc - ADC_SP;
+    // The offset is stored as a 14-bit two's complement value.
+    gCalGain = gain;
+    gCalOffset = (int16_t)(offset & 0x2000 ? offset | 0xC000 : offset);
+    gRegulationTarget = VoltsToAdc(HV_TARGET);
+    SetTargets(gRegulationTarget, VoltsToAdc(HV_LIMIT));
+}
+
+void BoostConverter_Init(void)
+{
+    LoadCalibration();
+    
+#ifndef BOOST_CONTROL_STEPPER
+    gIntegrator = (int32_t)gPwmDutyCycle << PI_I_FRACTION;
+#endif
+    
+    SetPwmDutyCycle(gPwmDutyCycle / PWM_DC_SCALAR);
+}
+
+#ifdef BOOST_CONTROL_STEPPER
+
+static void FeedForward(int16_t dDutyCycle)
+{
+    int16_t dutyCycle = (int16_t)gPwmDutyCycle + dDutyCycle;
+    if (dutyCycle < PWM_DC_MIN) dutyCycle = PWM_DC_MIN;
+    if (dutyCycle > (int16_t)PWM_DC_MAX) dutyCycle = (int16_t)PWM_DC_MAX;
+    
+    gPwmDutyCycle = (uint16_t)dutyCycle;
+}
+
+static void UpdateDutyCycle(uint16_t cv)
+{
+    int16_t cvError = (int16_t)(cv >> ADC_FRACTION_BITS) - (int16_t)(gSetpoint >> ADC_FRACTION_BITS);
     uint16_t dPwmDc = 0;
     if (cvError > 0)
     {
@@ -91,18 +277,219 @@ void BoostConverter_Update(uint16_t adc)
         if (gPwmDutyCycle + dPwmDc < PWM_DC_100) gPwmDutyCycle += dPwmDc;
         else dPwmDc = PWM_DC_100;
     }
+}
+
+#else
+
+static void FeedForward(int16_t dDutyCycle)
+{
+    // Moving the integrator moves the output without a bump; the slew limit still applies.
+    gIntegrator += (int32_t)dDutyCycle << PI_I_FRACTION;
+    
+    if (gIntegrator < ((int32_t)PWM_DC_MIN << PI_I_FRACTION)) gIntegrator = (int32_t)PWM_DC_MIN << PI_I_FRACTION;
+    if (gIntegrator > ((int32_t)PWM_DC_MAX << PI_I_FRACTION)) gIntegrator = (int32_t)PWM_DC_MAX << PI_I_FRACTION;
+}
+
+static void UpdateDutyCycle(uint16_t cv)
+{
+    // Positive when the voltage is low.
+    int16_t error = (int16_t)(gSetpoint - cv);
+    
+    int32_t integrator = gIntegrator + ((int32_t)error << PI_KI_SHIFT);
+    int32_t sum = (integrator + ((int32_t)error << PI_KP_SHIFT)) >> PI_I_FRACTION;
+    
+    // Clamp to the allowed range, then limit the slew from the current duty cycle.
+    int8_t limited = 0;
+    int16_t output;
+    if (sum > (int16_t)PWM_DC_MAX) { output = (int16_t)PWM_DC_MAX; limited = 1; }
+    else if (sum < PWM_DC_MIN) { output = PWM_DC_MIN; limited = -1; }
+    else output = (int16_t)sum;
+    
+    int16_t slew = output - (int16_t)gPwmDutyCycle;
+    if (slew > PI_SLEW_MAX) { output = (int16_t)gPwmDutyCycle + PI_SLEW_MAX; limited = 1; }
+    if (slew < -PI_SLEW_MAX) { output = (int16_t)gPwmDutyCycle - PI_SLEW_MAX; limited = -1; }
+    
+    // Anti-windup: don't integrate further into a limit. Integrating back out of it is fine.
+    if (!(limited > 0 && error > 0) && !(limited < 0 && error < 0)) gIntegrator = integrator;
+    
+    gPwmDutyCycle = (uint16_t)output;
+}
+
+#endif
+
+static void RampSetpoint(uint16_t cv)
+{
+    uint16_t target = gTarget;
+    
+    // Start the ramp from where the output is, so the loop starts with no error.
+    if (!gSetpoint) gSetpoint = cv;
+    
+    if (gSetpoint + SOFT_START_STEP < target)
+    {
+        if (gSetpoint < cv + SOFT_START_LEAD) gSetpoint += SOFT_START_STEP;
+        return;
+    }
+    
+    if (gSetpoint > target + SOFT_START_STEP)
+    {
+        gSetpoint -= SOFT_START_STEP;
+        return;
+    }
+    
+    gSetpoint = target;
+    if (gHvReady) return;
+    
+    uint16_t error = cv > target ? cv - target : target - cv;
+    if (error > HV_READY_BAND) gReadyCount = 0;
+    else if (++gReadyCount >= HV_READY_UPDATES) gHvReady = 1;
+}
+
+static void MonitorRange(uint16_t cv)
+{
+    // Nothing is lit before the soft-start finishes.
+    if (!gHvReady) return;
+    
+    if (gOverVoltageProtection || cv + gDeadband < gSetpoint || cv > gSetpoint + gDeadband)
+    {
+        gHvInRange = 0;
+        gRestoreCount = 0;
+        if (gExcursionUpdates < UINT16_MAX) ++gExcursionUpdates;
+        
+        return;
+    }
+    
+    if (gHvInRange || ++gRestoreCount < HV_RESTORE_UPDATES) return;
+    
+    // The time out of range, not counting the wait to restore.
+    uint16_t ms = gExcursionUpdates / (ADC_UPDATE_FREQ / 1000);
+    gLastExcursion = ms;
+    if (ms > gLongestExcursion) gLongestExcursion = ms;
+    ++gExcursionCount;
+    
+    gExcursionUpdates = 0;
+    gHvInRange = 1;
+}
+
+void BoostConverter_Update(uint16_t cv)
+{
+#ifdef SKIP_PD
+    return;
+#endif
+    
+    MonitorRange(cv);
+    
+#ifdef TELEMETRY_ENABLED
+    // The duty cycle is the one that produced this reading.
+    uint8_t events = gHvInRange ? TELEMETRY_EVENT_NONE : TELEMETRY_EVENT_WINDOW;
+    if (gOverVoltageProtection || cv > gHiLimit) events |= TELEMETRY_EVENT_OVP;
+    Telemetry_Record(cv, gOverVoltageProtection ? 0 : gPwmDutyCycle / PWM_DC_SCALAR, events);
+#endif
+    
+    // If save voltage levels are exceeded, stop the PWM.
+    if (cv > gHiLimit)
+    {
+        PWM_Disable();
+        gOverVoltageProtection = 1;
+        
+        return;
+    }
+    
+    // While in OVP, wait for voltage to drop back to a save level before halving the PWM DC and restarting.
+    if (gOverVoltageProtection)
+    {
+        if (cv > gTarget) return;
+        
+        gPwmDutyCycle /= 2;
+#ifndef BOOST_CONTROL_STEPPER
+        // Restart the integrator from the reduced duty cycle so it doesn't carry the overshoot.
+        gIntegrator = (int32_t)gPwmDutyCycle << PI_I_FRACTION;
+#endif
+        PWM_Enable(gPwmDutyCycle / PWM_DC_SCALAR);
+        
+        gOverVoltageProtection = 0;
+        return;
+    }
+    
+    RampSetpoint(cv);
+    
+    uint8_t load = gExpectedLoad;
+    if (load != gAppliedLoad)
+    {
+        FeedForward((int16_t)FeedForwardDuty(load) - (int16_t)FeedForwardDuty(gAppliedLoad));
+        gAppliedLoad = load;
+    }
+    
+    UpdateDutyCycle(cv);
     
     SetPwmDutyCycle(gPwmDutyCycle / PWM_DC_SCALAR);
 }
 
+void BoostConverter_SetExpectedLoad(uint8_t load)
+{
+    gExpectedLoad = load;
+}
+
+uint16_t BoostConverter_GetDeciVolts(void)
+{
+    int32_t volts = AdcToVolts(Adc_GetDisplayValue());
+    if (volts < 0) return 0;
+    
+    return (uint16_t)((volts * 10 + (1 << (CAL_OFFSET_BITS - 1))) >> CAL_OFFSET_BITS);
+}
+
 uint8_t BoostConverter_GetVoltage(void)
 {
-    // (4096 * ADC) / 1024 = mV on pin.
+    // Uncalibrated, (4096 * ADC) / 1024 = mV on pin.
     // multiply by 63.5 to compensate for the voltage divider supplying the pin.
     // divide by 1000 to convert from mV to volts
-    // This works out to (63.5 * (4096 / 1024)) / 1000 = 0.254, or ~(1/4 + 1/250).
-    // The exact values used will depend on the precise value of the resistors.
-    return (uint8_t)(gAdcCv / 4) - (uint8_t)(gAdcCv / 330);
+    // This works out to (63.5 * (4096 / 1024)) / 1000 = 0.254, or ~(1/4 - 1/330) with the nominal resistors.
+    int32_t volts = (AdcToVolts(Adc_GetDisplayValue()) + (1 << (CAL_OFFSET_BITS - 1))) >> CAL_OFFSET_BITS;
+    if (volts < 0) return 0;
+    if (volts > UINT8_MAX) return UINT8_MAX;
+    
+    return (uint8_t)volts;
+}
+
+void BoostConverter_HoldCalibrationPoint(uint8_t point)
+{
+    uint16_t target = gRegulationTarget;
+    if (HV_CAL_POINT_LO == point) target = VoltsToAdc(HV_CAL_LO);
+    if (HV_CAL_POINT_HI == point) target = VoltsToAdc(HV_CAL_HI);
+    
+    SetTargets(target, gHiLimit);
+}
+
+void BoostConverter_CaptureCalibrationPoint(uint8_t point, uint16_t decivolts)
+{
+    gCalPoints[point].cv = Adc_GetDisplayValue();
+    gCalPoints[point].decivolts = decivolts;
+}
+
+uint8_t BoostConverter_SaveCalibration(void)
+{
+    const struct CalibrationPoint* lo = &gCalPoints[HV_CAL_POINT_LO];
+    const struct CalibrationPoint* hi = &gCalPoints[HV_CAL_POINT_HI];
+    
+    if (hi->decivolts <= lo->decivolts || hi->cv <= lo->cv) return 0;
+    
+    uint16_t span = hi->decivolts - lo->decivolts;
+    if (span < CAL_MIN_SPAN || span > CAL_MAX_SPAN) return 0;
+    
+    // The slope between the points, then the offset through the low one. The voltages are in 0.1V.
+    uint32_t gain = (((uint32_t)span << (CAL_SHIFT + CAL_OFFSET_BITS)) / 10)
+        / (hi->cv - lo->cv);
+    if (gain < CAL_GAIN_MIN || gain > CAL_GAIN_MAX) return 0;
+    
+    int32_t offset = (((int32_t)lo->decivolts << CAL_OFFSET_BITS) / 10)
+        - (int32_t)(((uint32_t)lo->cv * gain) >> CAL_SHIFT);
+    if (offset < -CAL_OFFSET_MAX || offset > CAL_OFFSET_MAX) return 0;
+    
+    // The gain and offset are adjacent words, so they take one erase and write.
+    uint16_t words[] = { (uint16_t)gain, (uint16_t)offset & NVM_EMPTY };
+    Nvm_WriteWords(NVM_WORD_HV_GAIN, words, sizeof(words) / sizeof(words[0]));
+    LoadCalibration();
+    
+    return 1;
 }
 
 uint16_t BoostConverter_GetDutyCycle(void)
@@ -115,6 +502,33 @@ uint16_t BoostConverter_GetDutyCyclePct(void)
     return gPwmDutyCycle / (PWM_DC_100 / 100);
 }
 
+uint8_t BoostConverter_HvReady(void)
+{
+#ifdef SKIP_PD
+    return 1;
+#else
+    return gHvReady;
+#endif
+}
+
+uint8_t BoostConverter_HvInRange(void)
+{
+    return gHvInRange;
+}
+
+void BoostConverter_GetExcursions(uint16_t* count, uint16_t* lastMs, uint16_t* longestMs)
+{
+    // These are updated by the ISR, so read them atomically.
+    uint8_t gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    
+    *count = gExcursionCount;
+    *lastMs = gLastExcursion;
+    *longestMs = gLongestExcursion;
+    
+    INTCONbits.GIE = gie;
+}
+
 uint8_t BoostConverter_OverVoltageProtectionOn(void)
 {
     return gOverVoltageProtection;
@@ -9,19 +9,68 @@
 #define HV_MIN (HV_TARGET - HV_DEADBAND)
 #define HV_MAX (HV_TARGET + HV_DEADBAND)
 
-///
-/// Initializes the boost converter.
+// The maximum allowed voltage, once calibrated.
+#define HV_LIMIT 200
+
+#ifndef SKIP_PD
+    // This defines the maximum allowed voltage (~200V) until the board is calibrated.
+    #define ADC_HI_LIMIT 787L
+#else
+    // ~12V if we're in debug and running off the PICKit.
+    #define ADC_HI_LIMIT 47L
+#endif
+
+// Calibration holds the output at each of these voltages in turn, by the current calibration, while it's measured.
+#define HV_CAL_LO 150
+#define HV_CAL_HI 190
+
+// The most the measured voltage can be dialed up to, in 0.1V units.
+#define HV_CAL_MAX_DECIVOLTS 2550
+
+#define HV_CAL_POINT_LO 0
+#define HV_CAL_POINT_HI 1
+#define HV_CAL_POINT_NONE 0xFF
+
+/// Initializes the boost converter, loading its calibration from NVM. The PWM starts at the minimum duty cycle and
+/// soft-starts on the following updates.
 void BoostConverter_Init(void);
 
 ///
 /// Adjusts the boost converter's PWM duty-cycle based on the current ADC reading.
-/// @param adc The current ADC value.
-void BoostConverter_Update(uint16_t adc);
+/// @param cv The filtered ADC value, with ADC_FRACTION_BITS fractional bits.
+void BoostConverter_Update(uint16_t cv);
+
+/// Sets the load the tubes are expected to draw. Changes are fed forward to the duty cycle on the next update, ahead of
+/// the voltage sag or overshoot they would cause.
+///
+/// @param load The expected load, in 1/16ths of a lit digit cathode (see NIXIE_DIGIT_LOAD).
+void BoostConverter_SetExpectedLoad(uint8_t load);
 
 ///
 /// @returns The voltage level.
 uint8_t BoostConverter_GetVoltage(void);
 
+///
+/// @returns The voltage level in 0.1V units.
+uint16_t BoostConverter_GetDeciVolts(void);
+
+/// Moves the output to a calibration point so it can be measured. The output ramps there, as in the soft-start.
+///
+/// @param point HV_CAL_POINT_LO or HV_CAL_POINT_HI, or HV_CAL_POINT_NONE to return to HV_TARGET.
+void BoostConverter_HoldCalibrationPoint(uint8_t point);
+
+/// Records the measured output voltage at a calibration point, against the current (display-filtered) ADC value.
+///
+/// @param point HV_CAL_POINT_LO or HV_CAL_POINT_HI.
+/// @param decivolts The voltage measured at the output, in 0.1V units.
+void BoostConverter_CaptureCalibrationPoint(uint8_t point, uint16_t decivolts);
+
+/// Computes the gain and offset from the two captured points, saves them to NVM and applies them. The setpoint
+/// becomes HV_TARGET and the OVP limit HV_LIMIT, as measured.
+///
+/// @returns 0 if the points were unusable, in which case the calibration is unchanged.
+uint8_t BoostConverter_SaveCalibration(void);
+
 ///
 /// @returns The raw duty cycle value set to the PWM.
 uint16_t BoostConverter_GetDutyCycle(void);
@@ -31,6 +80,25 @@ uint16_t BoostConverter_GetDutyCycle(void);
 /// @note This is a fixed-precision value with 1 decimal digit.
 uint16_t BoostConverter_GetDutyCyclePct(void);
 
+/// Signals the end of the soft-start: the setpoint has ramped up and the voltage has settled on it. It stays set
+/// afterwards, so it's a power-up gate rather than a regulation check (see BoostConverter_GetVoltage for that).
+///
+/// @returns !=0 once the HV rail is ready to drive the tubes.
+uint8_t BoostConverter_HvReady(void);
+
+/// Checks the output against HV_MIN-HV_MAX, once HV is ready. It drops as soon as the filtered output leaves the range
+/// (or OVP trips), and is restored once it has been back inside for ~50ms.
+///
+/// @returns !=0 while the tubes can be lit.
+uint8_t BoostConverter_HvInRange(void);
+
+/// Reports the excursions outside HV_MIN-HV_MAX since power-up. An excursion is counted when it ends.
+///
+/// @param count Receives the number of excursions.
+/// @param lastMs Receives the duration of the last one, in ms.
+/// @param longestMs Receives the duration of the longest one, in ms.
+void BoostConverter_GetExcursions(uint16_t* count, uint16_t* lastMs, uint16_t* longestMs);
+
 ///
 /// @returns 0 if OVP is off, !=0 if it is on.
 uint8_t BoostConverter_OverVoltageProtectionOn(void);
@@ -0,0 +1,148 @@
+#include "boot.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "time_sync.h"
+#include "oled.h"
+#include "ui.h"
+#include "ap33772.h"
+#include "adc.h"
+#include "pwm.h"
+#include "boost_control.h"
+#include "nixie.h"
+#include "button.h"
+
+// Time for other devices (*cough*OLED*cough*) to finish power-up.
+#define OLED_POWER_UP_MS 50
+
+#define US_PER_UNIT (BOOT_TIME_UNIT_MS * 1000ul)
+
+// The microsecond timer wraps after ~71 minutes, so Boot_Task keeps running until the milestone times saturate, and
+// latches that here, unless every milestone has been reached first.
+#define SATURATED_US ((BOOT_NOT_REACHED - 1) * US_PER_UNIT)
+
+static uint8_t gState = BOOT_STATE_PD;
+static uint8_t gTask = SCHEDULER_NO_TASK;
+static uint32_t gStart;
+static uint8_t gDisplayReady = 0;
+static uint8_t gTubesLit = 0;
+static uint8_t gSaturated = 0;
+
+static uint16_t gMilestones[BOOT_MILESTONE_COUNT];
+
+void Boot_Init(void)
+{
+    gStart = Timer_GetMicros();
+    
+    for (uint8_t i = 0; i < BOOT_MILESTONE_COUNT; ++i) gMilestones[i] = BOOT_NOT_REACHED;
+    
+    // The time is ready to show as soon as the OLED is.
+    TimeSync_ReadRtc();
+    
+    gTask = Scheduler_AddPeriodic(&Boot_Task, BOOT_PERIOD);
+}
+
+void Boot_Mark(uint8_t milestone)
+{
+    if (BOOT_NOT_REACHED != gMilestones[milestone]) return;
+    
+    uint32_t units = gSaturated ? BOOT_NOT_REACHED - 1 : Timer_MicrosSince(gStart) / US_PER_UNIT;
+    gMilestones[milestone] = units < BOOT_NOT_REACHED ? (uint16_t)units : BOOT_NOT_REACHED - 1;
+}
+
+static uint8_t AllMarked(void)
+{
+    for (uint8_t i = 0; i < BOOT_MILESTONE_COUNT; ++i)
+    {
+        if (BOOT_NOT_REACHED == gMilestones[i]) return 0;
+    }
+    
+    return 1;
+}
+
+static void StartDisplay(void)
+{
+    OLED_Init();
+    gDisplayReady = 1;
+    
+    // Power-on can be detected as a state change in buttons. That should have stabilized by now, so reset the edge
+    // states.
+    Button_ResetEdges();
+    
+    UI_Update();
+    Boot_Mark(BOOT_MILESTONE_DISPLAY);
+}
+
+static void StartHv(void)
+{
+    Boot_Mark(BOOT_MILESTONE_PD);
+    
+    InitAdc();
+    InitPWM();
+    BoostConverter_Init();
+    
+    gState = BOOT_STATE_HV;
+}
+
+// The tubes stay blank until the HV rail has soft-started, so they don't load it while it ramps. They then show the
+// time straight away rather than at the next RTC read.
+static void LightTubes(void)
+{
+    Boot_Mark(BOOT_MILESTONE_HV);
+    
+    gTubesLit = 1;
+    UpdateNixieDrivers();
+    Boot_Mark(BOOT_MILESTONE_TUBES);
+    
+    gState = BOOT_STATE_DONE;
+}
+
+void Boot_Task(void)
+{
+    if (Timer_MicrosSince(gStart) >= SATURATED_US) gSaturated = 1;
+    
+    if (!gDisplayReady && Timer_MicrosSince(gStart) >= OLED_POWER_UP_MS * 1000ul) StartDisplay();
+    
+    switch (gState)
+    {
+        case BOOT_STATE_PD:
+#ifdef SKIP_PD
+            StartHv();
+#else
+            switch (AP33772_Negotiate())
+            {
+                case AP33772_NEGOTIATE_DONE: StartHv(); break;
+                case AP33772_NEGOTIATE_FAILED: gState = BOOT_STATE_FAILED; break;
+            }
+#endif
+            break;
+    
+        case BOOT_STATE_HV:
+            if (BoostConverter_HvReady()) LightTubes();
+            break;
+    }
+    
+    if (!gDisplayReady || !(BOOT_STATE_DONE == gState || BOOT_STATE_FAILED == gState)) return;
+    
+    // Later milestones (the GPS ones) still need a time that can't have wrapped.
+    if (gSaturated || AllMarked()) Scheduler_Cancel(gTask);
+}
+
+uint16_t Boot_GetMilestone(uint8_t milestone)
+{
+    return gMilestones[milestone];
+}
+
+uint8_t Boot_GetState(void)
+{
+    return gState;
+}
+
+uint8_t Boot_DisplayReady(void)
+{
+    return gDisplayReady;
+}
+
+uint8_t Boot_TubesLit(void)
+{
+    return gTubesLit;
+}
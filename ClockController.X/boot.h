@@ -0,0 +1,68 @@
+#ifndef BOOT_H
+#define	BOOT_H
+
+#include <xc.h>
+
+/*
+ * Start-up runs as a state machine in Boot_Task rather than in line in main(), so nothing waits on anything it doesn't
+ * need. The RTC is read at once and the OLED shows the time as soon as it has powered up, while the USB PD contract is
+ * negotiated. The HV rail soft-starts as soon as there's a contract, and the tubes show the time as soon as it's ready.
+ * The GPS receiver is configured alongside all of this (see GpsConfig_Task).
+ *
+ * Each milestone is timestamped from Boot_Init, and the timeline is shown on the OLED boot page and sent as a
+ * diagnostic record (see diag.h).
+ */
+
+#define BOOT_PERIOD 10
+
+#define BOOT_STATE_PD 0     ///< Negotiating the USB PD contract
+#define BOOT_STATE_HV 1     ///< Soft-starting the HV rail
+#define BOOT_STATE_DONE 2   ///< The tubes are lit.
+#define BOOT_STATE_FAILED 3 ///< No usable USB PD contract. The HV stays off, but the clock and OLED run.
+
+#define BOOT_MILESTONE_DISPLAY 0    ///< The RTC time is on the OLED.
+#define BOOT_MILESTONE_PD 1         ///< The USB PD contract is in place.
+#define BOOT_MILESTONE_HV 2         ///< The HV rail is ready.
+#define BOOT_MILESTONE_TUBES 3      ///< The time is on the tubes.
+#define BOOT_MILESTONE_GPS_CONFIG 4 ///< The GPS receiver configuration has finished, whether or not it succeeded.
+#define BOOT_MILESTONE_GPS_TIME 5   ///< The first valid GPS time was applied.
+#define BOOT_MILESTONE_COUNT 6
+
+// Milestone times are in 10ms units, and saturate just short of BOOT_NOT_REACHED (~11 minutes).
+#define BOOT_TIME_UNIT_MS 10
+#define BOOT_NOT_REACHED 0xFFFF
+
+///
+/// Starts the clock for the milestones and schedules Boot_Task. Needs the timers running.
+void Boot_Init(void);
+
+///
+/// Advances the start-up. Cancels itself once the tubes are lit (or the USB PD negotiation has failed), and every
+/// milestone has been reached or the milestone times have saturated.
+void Boot_Task(void);
+
+/// Records the time of a milestone. Only the first call for each milestone counts.
+///
+/// @param milestone One of the BOOT_MILESTONE_XXX values.
+void Boot_Mark(uint8_t milestone);
+
+/// Gets the time of a milestone.
+///
+/// @param milestone One of the BOOT_MILESTONE_XXX values.
+/// @returns The time since Boot_Init in BOOT_TIME_UNIT_MS, or BOOT_NOT_REACHED.
+uint16_t Boot_GetMilestone(uint8_t milestone);
+
+///
+/// @returns One of the BOOT_STATE_XXX values.
+uint8_t Boot_GetState(void);
+
+///
+/// @returns 1 once the OLED has been initialized and can be drawn on.
+uint8_t Boot_DisplayReady(void);
+
+///
+/// @returns 1 once the tubes have been lit.
+uint8_t Boot_TubesLit(void);
+
+#endif	/* BOOT_H */
+
@@ -1,6 +1,9 @@
 #ifndef CONFIG_BITS_H
 #define	CONFIG_BITS_H
 
+// For AP33772_INT_ENABLED, which takes the MCLR pin.
+#include "ap33772.h"
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -16,7 +19,11 @@ extern "C" {
 #pragma config VDDAR = HI       // VDD Range Analog Calibration Selection bit (Internal analog systems are calibrated for operation between VDD = 2.3V - 5.5V)
 
 // CONFIG2
+#ifdef AP33772_INT_ENABLED
+#pragma config MCLRE = INTMCLR  // Master Clear Enable bit (If LVP = 0, MCLR pin function is port defined function; If LVP = 1, RA3 pin function is MCLR)
+#else
 #pragma config MCLRE = EXTMCLR  // Master Clear Enable bit (If LVP = 0, MCLR pin is MCLR; If LVP = 1, RA3 pin function is MCLR)
+#endif
 #pragma config PWRTS = PWRT_OFF // Power-up Timer Selection bits (PWRT is disabled)
 #pragma config WDTE = OFF       // WDT Operating Mode bits (WDT disabled; SEN is ignored)
 #pragma config BOREN = ON       // Brown-out Reset Enable bits (Brown-out Reset Enabled, SBOREN bit is ignored)
@@ -34,7 +41,11 @@ extern "C" {
 #pragma config WRTB = OFF       // Boot Block Write Protection bit (Boot Block is not write-protected)
 #pragma config WRTC = OFF       // Configuration Registers Write Protection bit (Configuration Registers are not write-protected)
 #pragma config WRTSAF = OFF     // Storage Area Flash (SAF) Write Protection bit (SAF is not write-protected)
+#ifdef AP33772_INT_ENABLED
+#pragma config LVP = OFF        // Low Voltage Programming Enable bit (High Voltage on MCLR/Vpp must be used for programming)
+#else
 #pragma config LVP = ON         // Low Voltage Programming Enable bit (Low Voltage programming enabled. MCLR/Vpp pin function is MCLR. MCLRE Configuration bit is ignored.)
+#endif
 
 // CONFIG5
 #pragma config CP = OFF         // User Program Flash Memory Code Protection bit (User Program Flash Memory code protection is disabled)
@@ -0,0 +1,350 @@
+#include "diag.h"
+#include "serial.h"
+
+#ifdef DIAG_ENABLED
+#include "rtc.h"
+#include "gps.h"
+#include "gps_config.h"
+#include "time_sync.h"
+#include "time_zone.h"
+#include "rtc_calibration.h"
+#include "boost_control.h"
+#include "ap33772.h"
+#include "i2c.h"
+#include "nixie.h"
+#include "boot.h"
+#endif
+
+// The worst cases for the transmit ring: every byte escaped.
+#define BEGIN_ROOM 5 // END, type, sequence
+#define PUT_ROOM 2
+#define END_ROOM 3 // CRC, END
+
+static uint8_t gFrameOpen = 0;
+static uint8_t gCrc = 0;
+static uint8_t gSequence = 0;
+
+uint8_t Diag_Crc8(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+        crc = (crc & 0x80) ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+    }
+    
+    return crc;
+}
+
+// Queues a byte with SLIP escaping. The caller has checked there's room.
+static void PutEscaped(uint8_t data)
+{
+    uint8_t escaped[2] = { DIAG_SLIP_ESC, data };
+    
+    if (DIAG_SLIP_END == data) escaped[1] = DIAG_SLIP_ESC_END;
+    else if (DIAG_SLIP_ESC == data) escaped[1] = DIAG_SLIP_ESC_ESC;
+    else
+    {
+        Serial_Queue(&data, sizeof(data));
+        return;
+    }
+    
+    Serial_Queue(escaped, sizeof(escaped));
+}
+
+uint8_t Diag_BeginFrame(uint8_t type)
+{
+    if (gFrameOpen || Serial_TxFree() < BEGIN_ROOM) return 0;
+    
+    // The leading END flushes any noise the receiver has collected.
+    uint8_t end = DIAG_SLIP_END;
+    Serial_Queue(&end, sizeof(end));
+    
+    gFrameOpen = 1;
+    gCrc = 0;
+    
+    Diag_Put(type);
+    Diag_Put(gSequence++);
+    
+    return 1;
+}
+
+uint8_t Diag_Put(uint8_t data)
+{
+    if (Serial_TxFree() < PUT_ROOM) return 0;
+    
+    gCrc = Diag_Crc8(gCrc, data);
+    PutEscaped(data);
+    
+    return 1;
+}
+
+uint8_t Diag_EndFrame(void)
+{
+    if (Serial_TxFree() < END_ROOM) return 0;
+    
+    PutEscaped(gCrc);
+    
+    uint8_t end = DIAG_SLIP_END;
+    Serial_Queue(&end, sizeof(end));
+    
+    gFrameOpen = 0;
+    return 1;
+}
+
+#ifdef DIAG_ENABLED
+
+#define RECORD_MAX 20
+#define RECORD_ROOM (BEGIN_ROOM + RECORD_MAX * PUT_ROOM + END_ROOM)
+#define COMMAND_MAX 8
+
+// The records sent in turn.
+static const uint8_t RECORDS[] =
+{
+    DIAG_RECORD_TIME,
+    DIAG_RECORD_BOOST,
+#ifndef SKIP_PD
+    DIAG_RECORD_PD,
+#endif
+    DIAG_RECORD_I2C,
+    DIAG_RECORD_NIXIE,
+    DIAG_RECORD_BOOT,
+};
+
+static uint8_t gRecord = 0;
+static uint8_t gInterval = 1;
+static uint8_t gCountdown = 0;
+
+static uint8_t gCommand[COMMAND_MAX];
+static uint8_t gCommandLen = 0;
+static uint8_t gEscape = 0;
+
+static uint8_t gAckPending = 0;
+static uint8_t gAck[2];
+
+static uint8_t Put16(uint8_t* payload, uint8_t len, uint16_t value)
+{
+    payload[len++] = (uint8_t)value;
+    payload[len++] = (uint8_t)(value >> 8);
+    
+    return len;
+}
+
+static uint8_t BuildTime(uint8_t* payload)
+{
+    uint8_t len = 0;
+    
+    payload[len++] = gRtcDateTime.year;
+    payload[len++] = gRtcDateTime.month;
+    payload[len++] = gRtcDateTime.day;
+    payload[len++] = gRtcDateTime.hour;
+    payload[len++] = gRtcDateTime.minute;
+    payload[len++] = gRtcDateTime.second;
+    payload[len++] = (uint8_t)gGpsData.status;
+    payload[len++] = GpsConfig_GetState();
+    payload[len++] = TimeSync_PpsLocked();
+    payload[len++] = TimeSync_GetWriteCount();
+    len = Put16(payload, len, (uint16_t)TimeSync_GetPhaseError());
+    len = Put16(payload, len, (uint16_t)RtcCalibration_GetDrift());
+    
+    return len;
+}
+
+static uint8_t BuildBoost(uint8_t* payload)
+{
+    uint8_t flags = 0;
+    if (BoostConverter_OverVoltageProtectionOn()) flags |= DIAG_BOOST_OVP;
+    if (BoostConverter_HvReady()) flags |= DIAG_BOOST_HV_READY;
+    if (BoostConverter_HvInRange()) flags |= DIAG_BOOST_HV_IN_RANGE;
+    
+    uint16_t count, lastMs, longestMs;
+    BoostConverter_GetExcursions(&count, &lastMs, &longestMs);
+    
+    uint8_t len = 0;
+    len = Put16(payload, len, BoostConverter_GetDeciVolts());
+    len = Put16(payload, len, BoostConverter_GetDutyCycle());
+    payload[len++] = flags;
+    len = Put16(payload, len, count);
+    len = Put16(payload, len, lastMs);
+    len = Put16(payload, len, longestMs);
+    
+    return len;
+}
+
+#ifndef SKIP_PD
+static uint8_t BuildPd(uint8_t* payload)
+{
+    struct AP33772_Status status;
+    AP33772_GetStatus(&status);
+    
+    uint8_t len = 0;
+    payload[len++] = status.status.raw;
+    len = Put16(payload, len, status.voltage);
+    len = Put16(payload, len, status.current);
+    payload[len++] = status.selectedPdoPos;
+    payload[len++] = status.pdoMaxVolts;
+    payload[len++] = status.pdoMaxAmps;
+    payload[len++] = status.temperature;
+    
+    return len;
+}
+#endif
+
+static uint8_t BuildI2c(uint8_t* payload)
+{
+    uint8_t len = 0;
+    payload[len++] = I2C_GetErrorCount();
+    payload[len++] = I2C_GetResetCount();
+    
+    struct I2cDeviceStats stats;
+    for (uint8_t device = 0; device < I2C_DEVICE_COUNT; ++device)
+    {
+        I2C_GetDeviceStats(device, &stats);
+        len = Put16(payload, len, stats.operations);
+        payload[len++] = stats.errors;
+    }
+    
+    return len;
+}
+
+static uint8_t BuildBoot(uint8_t* payload)
+{
+    uint8_t flags = 0;
+#ifndef SKIP_PD
+    if (AP33772_LowPower()) flags |= DIAG_BOOT_PD_LOW_POWER;
+#endif
+    
+    uint8_t len = 0;
+    payload[len++] = Boot_GetState();
+    payload[len++] = flags;
+    
+    for (uint8_t milestone = 0; milestone < BOOT_MILESTONE_COUNT; ++milestone)
+    {
+        len = Put16(payload, len, Boot_GetMilestone(milestone));
+    }
+    
+    return len;
+}
+
+// Records are queued whole. The caller has checked there's RECORD_ROOM.
+static void SendRecord(uint8_t type, const uint8_t* payload, uint8_t len)
+{
+    Diag_BeginFrame(type);
+    for (uint8_t i = 0; i < len; ++i) Diag_Put(payload[i]);
+    Diag_EndFrame();
+}
+
+static uint8_t ApplySetting(uint8_t setting, int16_t value)
+{
+    switch (setting)
+    {
+        case DIAG_SETTING_TIME_ZONE:
+        {
+            int8_t offset = (int8_t)(value & 0xFF);
+            uint8_t dst = (uint8_t)((uint16_t)value >> 8);
+            if (offset < -12 || offset > 14 || dst > DST_TYPE_AUTO_US) return DIAG_ACK_INVALID;
+            
+            gTimeZoneOffset = offset;
+            gDstType = dst;
+            TimeZone_Save();
+            
+            return DIAG_ACK_OK;
+        }
+        
+        case DIAG_SETTING_INTERVAL:
+            if (value < 0 || value > UINT8_MAX) return DIAG_ACK_INVALID;
+        
+            gInterval = (uint8_t)value;
+            gCountdown = 0;
+        
+            return DIAG_ACK_OK;
+        
+        default:
+            return DIAG_ACK_UNKNOWN;
+    }
+}
+
+static void HandleCommand(void)
+{
+    // type, sequence, setting, value, CRC
+    if (gCommandLen != 6 || DIAG_COMMAND_WRITE != gCommand[0]) return;
+    
+    // The CRC over the data and its own CRC is 0.
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < gCommandLen; ++i) crc = Diag_Crc8(crc, gCommand[i]);
+    if (crc) return;
+    
+    gAck[0] = gCommand[2];
+    gAck[1] = ApplySetting(gCommand[2], (int16_t)(gCommand[3] | ((uint16_t)gCommand[4] << 8)));
+    gAckPending = 1;
+}
+
+void Diag_Receive(uint8_t data)
+{
+    if (DIAG_SLIP_END == data)
+    {
+        if (gCommandLen) HandleCommand();
+        
+        gCommandLen = 0;
+        gEscape = 0;
+        return;
+    }
+    
+    if (DIAG_SLIP_ESC == data)
+    {
+        gEscape = 1;
+        return;
+    }
+    
+    if (gEscape)
+    {
+        if (DIAG_SLIP_ESC_END == data) data = DIAG_SLIP_END;
+        else if (DIAG_SLIP_ESC_ESC == data) data = DIAG_SLIP_ESC;
+        
+        gEscape = 0;
+    }
+    
+    // Anything too long isn't a command. It's dropped at the next END.
+    if (gCommandLen < COMMAND_MAX) gCommand[gCommandLen] = data;
+    if (gCommandLen < UINT8_MAX) ++gCommandLen;
+}
+
+void Diag_Task(void)
+{
+    // The receiver configuration owns the EUSART while it runs.
+    uint8_t config = GpsConfig_GetState();
+    if (GPS_CONFIG_STATE_PENDING == config || GPS_CONFIG_STATE_VERIFYING == config) return;
+    
+    // Wait for room, e.g. while telemetry is being sent.
+    if (gFrameOpen || Serial_TxFree() < RECORD_ROOM) return;
+    
+    if (gAckPending)
+    {
+        SendRecord(DIAG_RECORD_ACK, gAck, sizeof(gAck));
+        gAckPending = 0;
+        return;
+    }
+    
+    if (!gInterval || ++gCountdown < gInterval) return;
+    gCountdown = 0;
+    
+    uint8_t payload[RECORD_MAX];
+    uint8_t len = 0;
+    uint8_t type = RECORDS[gRecord];
+    
+    switch (type)
+    {
+        case DIAG_RECORD_TIME: len = BuildTime(payload); break;
+        case DIAG_RECORD_BOOST: len = BuildBoost(payload); break;
+#ifndef SKIP_PD
+        case DIAG_RECORD_PD: len = BuildPd(payload); break;
+#endif
+        case DIAG_RECORD_I2C: len = BuildI2c(payload); break;
+        case DIAG_RECORD_NIXIE: len = Put16(payload, 0, gNixieStatus); break;
+        case DIAG_RECORD_BOOT: len = BuildBoot(payload); break;
+    }
+    
+    SendRecord(type, payload, len);
+    if (++gRecord >= sizeof(RECORDS)) gRecord = 0;
+}
+
+#endif
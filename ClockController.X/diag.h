@@ -0,0 +1,108 @@
+#ifndef DIAG_H
+#define	DIAG_H
+
+#include <xc.h>
+
+/*
+ * A framed binary protocol on the EUSART for diagnostics, read by Host/diag_tool.c.
+ *
+ * Frames are SLIP encoded (RFC 1055): each starts and ends with DIAG_SLIP_END, and END and ESC bytes in the frame are
+ * escaped. A frame is a record type, a sequence number, the payload, and a CRC-8 (polynomial 0x07, initial value 0)
+ * over everything before it. Multi-byte fields are little-endian.
+ *
+ * The clock streams its state as DIAG_RECORD_XXX frames, and accepts DIAG_COMMAND_WRITE frames to change settings.
+ * The TX pin is wired to the GPS receiver's RX, which ignores the frames. Commands arrive on the same RX line as the
+ * receiver's output, so they're only seen when the host is wired in place of (or OR'd with) the receiver; NMEA never
+ * contains the SLIP END byte, and the CRC rejects anything else.
+ */
+
+// Defining this macro streams the diagnostic records and accepts settings from the host. The framing functions are
+// always available, for the telemetry.
+//#define DIAG_ENABLED
+
+// SLIP framing bytes
+#define DIAG_SLIP_END 0xC0
+#define DIAG_SLIP_ESC 0xDB
+#define DIAG_SLIP_ESC_END 0xDC
+#define DIAG_SLIP_ESC_ESC 0xDD
+
+// Record types, clock to host. The payload layouts are:
+//   TIME: year, month, day, hour, minute, second (RTC, local), GPS status ('A'/'V'), GPS config state
+//         (GPS_CONFIG_STATE_XXX), PPS locked, RTC write count, phase error (int16, 0.1ms), drift (int16, 0.01ppm)
+//   BOOST: voltage (uint16, 0.1V), duty cycle (uint16, PWM counts), flags (DIAG_BOOST_XXX), excursion count, last and
+//          longest excursion in ms (uint16 each)
+//   PD: status (AP33772 status byte), voltage (uint16, mV), current (uint16, mA), selected PDO position, PDO max volts,
+//       PDO max amps, temperature (degrees C)
+//   I2C: error count, reset count, then per I2C_DEVICE_XXX: operations (uint16), errors
+//   NIXIE: gNixieStatus (uint16)
+//   BOOT: boot state (BOOT_STATE_XXX), flags (DIAG_BOOT_XXX), then per BOOT_MILESTONE_XXX: the time since start-up
+//         (uint16, BOOT_TIME_UNIT_MS, BOOT_NOT_REACHED until reached)
+//   TELEMETRY: a frozen telemetry capture (see telemetry.h)
+//   ACK: setting, DIAG_ACK_XXX
+#define DIAG_RECORD_TIME 0x01
+#define DIAG_RECORD_BOOST 0x02
+#define DIAG_RECORD_PD 0x03
+#define DIAG_RECORD_I2C 0x04
+#define DIAG_RECORD_NIXIE 0x05
+#define DIAG_RECORD_BOOT 0x06
+#define DIAG_RECORD_TELEMETRY 0x10
+#define DIAG_RECORD_ACK 0x7F
+
+#define DIAG_BOOST_OVP 0x01
+#define DIAG_BOOST_HV_READY 0x02
+#define DIAG_BOOST_HV_IN_RANGE 0x04
+
+#define DIAG_BOOT_PD_LOW_POWER 0x01
+
+// Commands, host to clock. WRITE carries a DIAG_SETTING_XXX and a value (int16), and is answered with an ACK. Only one
+// ACK is held, so the host waits for each before sending the next command.
+#define DIAG_COMMAND_WRITE 0x80
+
+// The time zone offset in hours [-12..14] in the low byte, and the DST type (DST_TYPE_XXX) in the high byte. Saved.
+#define DIAG_SETTING_TIME_ZONE 0x01
+
+// The number of Diag_Task calls between records. 0 stops the stream until the next reset.
+#define DIAG_SETTING_INTERVAL 0x02
+
+#define DIAG_ACK_OK 0
+#define DIAG_ACK_UNKNOWN 1
+#define DIAG_ACK_INVALID 2
+
+/// Starts a frame. Frames can't be interleaved, so this fails while another frame is being sent.
+///
+/// @param type The DIAG_RECORD_XXX type.
+/// @returns 1 if the frame was started, 0 if the transmit ring was too full or a frame is already open.
+uint8_t Diag_BeginFrame(uint8_t type);
+
+/// Adds a byte to the open frame.
+///
+/// @param data The byte to add.
+/// @returns 1 if the byte was queued, 0 if the transmit ring was too full. Retry the same byte later.
+uint8_t Diag_Put(uint8_t data);
+
+///
+/// @returns 1 if the frame was finished, 0 if the transmit ring was too full. Retry later.
+uint8_t Diag_EndFrame(void);
+
+/// Updates a CRC-8 (polynomial 0x07) with a byte.
+///
+/// @param crc The CRC so far. Start with 0.
+/// @param data The byte to add.
+/// @returns The updated CRC.
+uint8_t Diag_Crc8(uint8_t crc, uint8_t data);
+
+#ifdef DIAG_ENABLED
+
+///
+/// Sends the next record when it's due, and answers any command received. Called every ~200 ms, so each record is sent
+/// about once a second.
+void Diag_Task(void);
+
+///
+/// Feeds a received byte to the command parser. Called from the main loop for every byte received.
+void Diag_Receive(uint8_t data);
+
+#endif
+
+#endif	/* DIAG_H */
+
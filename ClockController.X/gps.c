@@ -3,13 +3,35 @@
 #include "gps.h"
 #include "bcd_utils.h"
 #include "time_utils.h"
+#include "ring_buffer.h"
+#include "ubx.h"
+#include "diag.h"
 
 /*
  * This receives and decodes the NMEA protocol RMC message sent by the GPS receiver. (20.10)
+ * Alternatively, the binary UBX NAV-TIMEUTC message is decoded if GPS_PROTOCOL_UBX is defined.
+ *
+ * The ISR only queues received bytes. The NMEA state machine runs from the main loop (GPS_Process) so that the time
+ * spent in the ISR stays short and bounded for the I2C and ADC interrupts.
  */
 
 volatile struct GpsData gGpsData;
 
+// At GPS_BAUD (57600) a byte arrives every ~174us, so the ring holds ~22ms of data, and an RMC sentence (~73 bytes)
+// fits whole. The main loop drains it while it waits on I2C (clearing the OLED alone takes ~11.5ms at 400kHz), so
+// this only has to cover the gaps between GpsTask calls and the longest task that doesn't use I2C.
+#define RX_BUFFER_SIZE 128
+
+static uint8_t gRxStorage[RX_BUFFER_SIZE];
+static struct RingBuffer gRxRing = RING_BUFFER_INIT(gRxStorage);
+
+static volatile uint8_t gUartOverruns = 0;
+static volatile uint8_t gFramingErrors = 0;
+
+// Counts of the messages started and the messages carrying the time, used to verify the receiver configuration.
+static uint8_t gSentenceCount = 0;
+static uint8_t gTimeCount = 0;
+
 volatile static struct
 {
     char time[6];
@@ -60,6 +82,8 @@ void AwaitStart(char data)
     {
         gState = STATE_CONSUME_HEADER;
         gCharCounter = 0;
+        
+        ++gSentenceCount;
     }
 }
 
@@ -76,6 +100,7 @@ void ConsumeHeader(char data)
     if (gCharCounter >= sizeof(HEADER) - 1)
     {
         // The header matches the message we want: start consuming fields;
+        ++gTimeCount;
         gState = STATE_AWAIT_FIELD;
         gField = FIELD_TIME;
         gCharCounter = 1;
@@ -140,18 +165,22 @@ void GPS_HandleInterrupt(void)
     {
         RC1STAbits.CREN = 0;
         RC1STAbits.CREN = 1;
+        
+        ++gUartOverruns;
     }
 
-    uint8_t error = RC1STAbits.FERR;
-
-    // Reset the state machine if there is a framing error.
-    if (error)
+    // Drop the byte if there is a framing error. The parser will resynchronize when it sees the error count change.
+    if (RC1STAbits.FERR)
     {
-        gState = STATE_AWAIT_START;
+        ++gFramingErrors;
         return;
     }
 
-    // Run the state machine.
+    RingBuffer_Put(&gRxRing, (uint8_t)data);
+}
+
+void GPS_ParseNmea(char data)
+{
     switch (gState)
     {
         case STATE_AWAIT_START: AwaitStart(data); break;
@@ -181,3 +210,176 @@ void GPS_HandleInterrupt(void)
         gState = STATE_AWAIT_START;
     }
 }
+
+//
+// UBX NAV-TIMEUTC decoding
+//
+// Fields are extracted directly from the little-endian payload, so there is no per-character decimal conversion. Frames
+// with a bad checksum are discarded.
+//
+
+#define UBX_STATE_SYNC_1 0
+#define UBX_STATE_SYNC_2 1
+#define UBX_STATE_CLASS 2
+#define UBX_STATE_ID 3
+#define UBX_STATE_LENGTH_LO 4
+#define UBX_STATE_LENGTH_HI 5
+#define UBX_STATE_PAYLOAD 6
+#define UBX_STATE_CK_A 7
+#define UBX_STATE_CK_B 8
+
+// NAV-TIMEUTC payload: iTOW, tAcc, nano, year (U2), month, day, hour, min, sec, valid. Only year onward is kept.
+#define TIMEUTC_LENGTH 20
+#define TIMEUTC_KEEP_OFFSET 12
+#define TIMEUTC_VALID_UTC 0x04
+
+static struct
+{
+    uint8_t state;
+    uint8_t msgClass;
+    uint8_t msgId;
+    uint8_t lengthLo;
+    uint16_t length;
+    uint16_t index;
+    
+    struct UbxChecksum checksum;
+    uint8_t checksumA;
+    
+    uint8_t payload[TIMEUTC_LENGTH - TIMEUTC_KEEP_OFFSET];
+} gUbx;
+
+uint8_t IsTimeUtc(void)
+{
+    return (UBX_CLASS_NAV == gUbx.msgClass) && (UBX_NAV_TIMEUTC == gUbx.msgId) && (TIMEUTC_LENGTH == gUbx.length);
+}
+
+void HandleUbxMessage(void)
+{
+    // Acknowledgements to our own configuration messages don't count as receiver output.
+    if (UBX_CLASS_ACK != gUbx.msgClass) ++gSentenceCount;
+    
+    if (!IsTimeUtc()) return;
+    
+    ++gTimeCount;
+    
+    gGpsData.datetime.year = (uint8_t)((gUbx.payload[0] | ((uint16_t)gUbx.payload[1] << 8)) - 2000);
+    gGpsData.datetime.month = gUbx.payload[2];
+    gGpsData.datetime.day = gUbx.payload[3];
+
+    gGpsData.datetime.hour = gUbx.payload[4];
+    gGpsData.datetime.minute = gUbx.payload[5];
+    gGpsData.datetime.second = gUbx.payload[6];
+
+    gGpsData.status = (gUbx.payload[7] & TIMEUTC_VALID_UTC) ? GPS_STATUS_VALID : GPS_STATUS_INVALID;
+
+    gGpsData.updated = 1;
+}
+
+void GPS_ParseUbx(uint8_t data)
+{
+    switch (gUbx.state)
+    {
+        case UBX_STATE_SYNC_1:
+            if (UBX_SYNC_1 == data) gUbx.state = UBX_STATE_SYNC_2;
+            
+            // Count any NMEA still arriving so the configuration can be verified.
+            else if ('$' == data) ++gSentenceCount;
+            return;
+            
+        case UBX_STATE_SYNC_2:
+            gUbx.state = (UBX_SYNC_2 == data) ? UBX_STATE_CLASS : UBX_STATE_SYNC_1;
+            gUbx.checksum.a = 0;
+            gUbx.checksum.b = 0;
+            return;
+            
+        case UBX_STATE_CK_A:
+            gUbx.checksumA = data;
+            gUbx.state = UBX_STATE_CK_B;
+            return;
+            
+        case UBX_STATE_CK_B:
+            if ((gUbx.checksumA == gUbx.checksum.a) && (data == gUbx.checksum.b)) HandleUbxMessage();
+            gUbx.state = UBX_STATE_SYNC_1;
+            return;
+    }
+    
+    // Everything from the class through the payload is covered by the checksum (31.4)
+    UBX_UpdateChecksum(&gUbx.checksum, data);
+    
+    switch (gUbx.state)
+    {
+        case UBX_STATE_CLASS:
+            gUbx.msgClass = data;
+            gUbx.state = UBX_STATE_ID;
+            break;
+            
+        case UBX_STATE_ID:
+            gUbx.msgId = data;
+            gUbx.state = UBX_STATE_LENGTH_LO;
+            break;
+            
+        case UBX_STATE_LENGTH_LO:
+            gUbx.lengthLo = data;
+            gUbx.state = UBX_STATE_LENGTH_HI;
+            break;
+            
+        case UBX_STATE_LENGTH_HI:
+            gUbx.length = gUbx.lengthLo | ((uint16_t)data << 8);
+            gUbx.index = 0;
+            gUbx.state = gUbx.length ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+            break;
+            
+        case UBX_STATE_PAYLOAD:
+            if (IsTimeUtc() && (gUbx.index >= TIMEUTC_KEEP_OFFSET))
+            {
+                gUbx.payload[gUbx.index - TIMEUTC_KEEP_OFFSET] = data;
+            }
+            
+            if (++gUbx.index >= gUbx.length) gUbx.state = UBX_STATE_CK_A;
+            break;
+            
+        // We should never get here.
+        default:
+            gUbx.state = UBX_STATE_SYNC_1;
+    }
+}
+
+void GPS_Process(void)
+{
+    static uint8_t lastErrorCount = 0;
+    
+    // Reset the state machine if any bytes were lost since the last pass. The sentence in progress can't be trusted.
+    uint8_t errorCount = gRxRing.overruns + gUartOverruns + gFramingErrors;
+    if (errorCount != lastErrorCount)
+    {
+        lastErrorCount = errorCount;
+        gState = STATE_AWAIT_START;
+        gUbx.state = UBX_STATE_SYNC_1;
+    }
+    
+    uint8_t data;
+    while (RingBuffer_Get(&gRxRing, &data))
+    {
+#ifdef GPS_PROTOCOL_UBX
+        GPS_ParseUbx(data);
+#else
+        GPS_ParseNmea((char)data);
+#endif
+#ifdef DIAG_ENABLED
+        Diag_Receive(data);
+#endif
+    }
+}
+
+void GPS_GetRxErrors(struct GpsRxErrors* errors)
+{
+    errors->bufferOverruns = gRxRing.overruns;
+    errors->uartOverruns = gUartOverruns;
+    errors->framingErrors = gFramingErrors;
+}
+
+void GPS_GetSentenceCounts(struct GpsSentenceCounts* counts)
+{
+    counts->total = gSentenceCount;
+    counts->time = gTimeCount;
+}
@@ -8,6 +8,9 @@
 #include <xc.h>
 #include "time_utils.h"
 
+// Defining this macro switches the receiver from the NMEA RMC sentence to the binary UBX NAV-TIMEUTC message.
+//#define GPS_PROTOCOL_UBX
+
 // Why is 'V' invalid and 'A' valid? IDK. (UBLOX �18)
 #define GPS_STATUS_VALID 'A'
 #define GPS_STATUS_INVALID 'V'
@@ -21,14 +24,55 @@ struct GpsData
     uint8_t updated; ///< Set when new data is available. Client should clear the bit after processing the data.
 };
 
+struct GpsRxErrors
+{
+    uint8_t bufferOverruns; ///< Bytes dropped because the receive ring was full.
+    uint8_t uartOverruns; ///< Bytes lost in the EUSART because the receive FIFO was full (OERR).
+    uint8_t framingErrors; ///< Bytes discarded because of framing errors (FERR).
+};
+
+///
+/// Free-running counts of received messages.
+struct GpsSentenceCounts
+{
+    uint8_t total; ///< All NMEA sentences and UBX output messages received.
+    uint8_t time; ///< Messages carrying the time (RMC or NAV-TIMEUTC).
+};
+
 ///
 /// The last read GPS data.
 volatile extern struct GpsData gGpsData;
 
 ///
 /// Called by the ISR to process GPS (serial) interrupts.
+/// @note This only queues the received byte. Parsing is deferred to GPS_Process.
 void GPS_HandleInterrupt(void);
 
+///
+/// Parses the bytes queued by the ISR with the parser selected by GPS_PROTOCOL_UBX. Called from the main loop, and
+/// while it waits for I2C transfers.
+void GPS_Process(void);
+
+/// Feeds a received byte to the NMEA RMC parser. gGpsData is updated when a sentence completes.
+///
+/// @param data The received byte.
+void GPS_ParseNmea(char data);
+
+/// Feeds a received byte to the UBX NAV-TIMEUTC parser. gGpsData is updated when a valid frame completes.
+///
+/// @param data The received byte.
+void GPS_ParseUbx(uint8_t data);
+
+/// Gets the cumulative receive error counts.
+///
+/// @param errors Receives the error counts.
+void GPS_GetRxErrors(struct GpsRxErrors* errors);
+
+/// Gets the counts of sentences received. Used to verify which sentences the receiver is emitting.
+///
+/// @param counts Receives the sentence counts.
+void GPS_GetSentenceCounts(struct GpsSentenceCounts* counts);
+
 /// Converts gGpsData.datetime to local time by applying the passed timezone offset.
 ///
 /// @param tzOffset The local time offset from UTC in hours.
@@ -0,0 +1,136 @@
+#include "gps_config.h"
+#include "gps.h"
+#include "serial.h"
+#include "ubx.h"
+
+/*
+ * The NEO-6M streams GGA, GLL, GSA, GSV, RMC and VTG by default. Only RMC is used, so everything else is turned off with
+ * UBX-CFG-MSG. With GPS_PROTOCOL_UBX, RMC is turned off too and NAV-TIMEUTC is turned on instead.
+ *
+ * The receiver may keep its configuration in battery-backed RAM, so it can already be running at GPS_BAUD after a
+ * reset. Attempts therefore alternate between sending the configuration at the default rate and at GPS_BAUD.
+ */
+
+// The number of task calls to watch the sentence stream for after sending the configuration. The receiver emits once a
+// second, so this needs to span a few seconds.
+#define VERIFY_PERIOD 150
+
+#define MAX_ATTEMPTS 4
+
+static const uint8_t DISABLED_SENTENCES[] =
+{
+    UBX_NMEA_GGA,
+    UBX_NMEA_GLL,
+    UBX_NMEA_GSA,
+    UBX_NMEA_GSV,
+    UBX_NMEA_VTG,
+#ifdef GPS_PROTOCOL_UBX
+    UBX_NMEA_RMC,
+#endif
+};
+
+#ifdef GPS_PROTOCOL_UBX
+    #define TIME_MESSAGE_CLASS UBX_CLASS_NAV
+    #define TIME_MESSAGE_ID UBX_NAV_TIMEUTC
+    #define OUT_PROTOCOL_MASK 0x01 // UBX only
+#else
+    #define TIME_MESSAGE_CLASS UBX_CLASS_NMEA
+    #define TIME_MESSAGE_ID UBX_NMEA_RMC
+    #define OUT_PROTOCOL_MASK 0x03 // UBX + NMEA
+#endif
+
+static uint8_t gConfigState = GPS_CONFIG_STATE_PENDING;
+static uint8_t gAttempt = 0;
+static uint8_t gVerifyCounter = 0;
+static struct GpsSentenceCounts gVerifyStart;
+
+void SetMessageRate(uint8_t msgClass, uint8_t msgId, uint8_t rate)
+{
+    // Payload: msgClass, msgID, rate on the current port
+    uint8_t payload[3] = { msgClass, msgId, rate };
+    UBX_Send(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+void SetPortBaud(uint32_t baud)
+{
+    // Payload: portID = UART1, reserved, txReady = off, mode = 8N1, baudRate, inProtoMask = UBX + NMEA,
+    //          outProtoMask, reserved
+    uint8_t payload[20] =
+    {
+        0x01, 0x00, 0x00, 0x00,
+        0xD0, 0x08, 0x00, 0x00,
+        (uint8_t)baud, (uint8_t)(baud >> 8), (uint8_t)(baud >> 16), 0x00,
+        0x03, 0x00,
+        OUT_PROTOCOL_MASK, 0x00,
+        0x00, 0x00, 0x00, 0x00
+    };
+    
+    UBX_Send(UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+}
+
+void SendConfiguration(void)
+{
+    // Alternate between the rate the receiver starts at, and the rate it may have retained from a previous boot.
+    Serial_SetBaud((gAttempt & 1) ? GPS_BAUD : SERIAL_DEFAULT_BAUD);
+    
+    for (uint8_t i = 0; i < sizeof(DISABLED_SENTENCES); ++i) SetMessageRate(UBX_CLASS_NMEA, DISABLED_SENTENCES[i], 0);
+    SetMessageRate(TIME_MESSAGE_CLASS, TIME_MESSAGE_ID, 1);
+    
+#if GPS_BAUD != SERIAL_DEFAULT_BAUD
+    SetPortBaud(GPS_BAUD);
+#endif
+    
+    // The new rate only applies once the last byte has been sent.
+    Serial_Flush();
+    Serial_SetBaud(GPS_BAUD);
+}
+
+void GpsConfig_Task(void)
+{
+    switch (gConfigState)
+    {
+        case GPS_CONFIG_STATE_PENDING:
+            SendConfiguration();
+            GPS_GetSentenceCounts(&gVerifyStart);
+            gVerifyCounter = VERIFY_PERIOD;
+            gConfigState = GPS_CONFIG_STATE_VERIFYING;
+            break;
+            
+        case GPS_CONFIG_STATE_VERIFYING:
+        {
+            if (--gVerifyCounter) break;
+            
+            struct GpsSentenceCounts counts;
+            GPS_GetSentenceCounts(&counts);
+            
+            uint8_t total = counts.total - gVerifyStart.total;
+            uint8_t time = counts.time - gVerifyStart.time;
+            
+            // Allow for one sentence that was already in progress when counting started.
+            if (time && (total <= time + 1))
+            {
+                gConfigState = GPS_CONFIG_STATE_OK;
+            }
+            else if (++gAttempt < MAX_ATTEMPTS)
+            {
+                gConfigState = GPS_CONFIG_STATE_PENDING;
+            }
+            else
+            {
+                // If nothing intelligible arrived at the new rate, go back to the rate the receiver starts at.
+                if (!time) Serial_SetBaud(SERIAL_DEFAULT_BAUD);
+                gConfigState = GPS_CONFIG_STATE_FAILED;
+            }
+            
+            break;
+        }
+            
+        default:
+            break;
+    }
+}
+
+uint8_t GpsConfig_GetState(void)
+{
+    return gConfigState;
+}
@@ -0,0 +1,27 @@
+#ifndef GPS_CONFIG_H
+#define	GPS_CONFIG_H
+
+#include <xc.h>
+
+///
+/// The baud rate the receiver is switched to once configured. Set to SERIAL_DEFAULT_BAUD to leave the rate alone.
+#define GPS_BAUD (57600ul)
+
+#define GPS_CONFIG_STATE_PENDING 0
+#define GPS_CONFIG_STATE_VERIFYING 1
+#define GPS_CONFIG_STATE_OK 2
+#define GPS_CONFIG_STATE_FAILED 3
+
+/// Advances the receiver configuration. Called periodically from the main loop.
+///
+/// The receiver is told to emit only the message carrying the time (RMC, or NAV-TIMEUTC with GPS_PROTOCOL_UBX), and
+/// optionally to switch to GPS_BAUD. The configuration is then verified by watching the incoming messages, and is
+/// retried if anything else is still being received.
+void GpsConfig_Task(void);
+
+///
+/// @returns One of the GPS_CONFIG_STATE_XXX values.
+uint8_t GpsConfig_GetState(void);
+
+#endif	/* GPS_CONFIG_H */
+
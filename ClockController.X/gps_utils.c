@@ -23,39 +23,7 @@ void RollDayBack()
     if (--gGpsData.datetime.day == 0)
     {
         RollMonthBack();
-        
-        switch (gGpsData.datetime.month)
-        {
-            // 31 day months
-            case 1: // January
-            case 3: // March
-            case 5: // May
-            case 7: // July
-            case 8: // August
-            case 10: // October
-            case 12: // December
-                gGpsData.datetime.day = 31;
-                break;
-                
-            // 30 day months
-            case 4: // April
-            case 6: // June
-            case 9: // September
-            case 11: // November
-                gGpsData.datetime.day = 30;
-                break;
-                
-            // February - I'm not bothering with anything more than standard leap days
-            case 2:
-            {
-                gGpsData.datetime.day = (gGpsData.datetime.year % 4) ? 29 : 28;
-                break;
-            }
-
-            default:
-                // LOL what?!?
-                break;
-        }
+        gGpsData.datetime.day = GetDaysInMonth(gGpsData.datetime.year, gGpsData.datetime.month);
     }
 }
 
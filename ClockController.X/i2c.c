@@ -2,6 +2,7 @@
 #include "i2c_register_bits.h"
 #include "clock.h"
 #include "pps_outputs.h"
+#include "gps.h"
 
 #ifdef _I2C_TRACE
     char gEventTrace[128] = {0};
@@ -59,6 +60,29 @@ static struct
 static uint8_t gErrorCount = 0;
 static uint8_t gResetCount = 0;
 
+// The operation counts are only updated by the main loop, and the error counts only by the ISR.
+static struct I2cDeviceStats gDeviceStats[I2C_DEVICE_COUNT];
+static uint8_t gDevice = I2C_DEVICE_OTHER;
+
+static uint8_t GetDevice(uint8_t address)
+{
+    if (address < 0x10) return I2C_DEVICE_NIXIE;
+    
+    switch (address)
+    {
+        case 0x3C: return I2C_DEVICE_OLED;
+        case 0x51: return I2C_DEVICE_PD;
+        case 0x68: return I2C_DEVICE_RTC;
+        default: return I2C_DEVICE_OTHER;
+    }
+}
+
+static void CountOperation(uint8_t address)
+{
+    gDevice = GetDevice(address);
+    ++gDeviceStats[gDevice].operations;
+}
+
 void ClearOp()
 {
     RESET_TRACE();
@@ -81,6 +105,7 @@ void HandleError()
     
     operation.state = STATE_ERROR;
     ++gErrorCount;
+    ++gDeviceStats[gDevice].errors;
     ClearOp();
 }
 
@@ -129,6 +154,13 @@ uint8_t IsDone()
     return OP_IDLE == operation.type;
 }
 
+// A page of OLED drawing keeps the main loop in here for tens of ms, longer than the GPS receive ring lasts at
+// GPS_BAUD. Parsing while waiting keeps it drained.
+static void WaitDone(void)
+{
+    while (!IsDone()) GPS_Process();
+}
+
 void I2C_Host_Init(void)
 {
     // disable slew rate control for standard speed
@@ -311,6 +343,7 @@ void ExecuteStateMachine()
 void I2C_Write(uint8_t address, const void* data, uint8_t len)
 {
     ResetBus();
+    CountOperation(address);
     
     operation.type = OP_WRITE;
     operation.address = address;
@@ -322,12 +355,13 @@ void I2C_Write(uint8_t address, const void* data, uint8_t len)
 
     Start();
     
-    while (!IsDone());
+    WaitDone();
 }
 
 void I2C_Read(uint8_t address, void* data, uint8_t len)
 {
     ResetBus();
+    CountOperation(address);
     
     operation.type = OP_READ;
     operation.address = address;
@@ -339,12 +373,13 @@ void I2C_Read(uint8_t address, void* data, uint8_t len)
 
     Start();
     
-    while (!IsDone());
+    WaitDone();
 }
 
 void I2C_WriteRead(uint8_t address, const void* writeData, uint8_t writeLen, void* readData, uint8_t readLen)
 {
     ResetBus();
+    CountOperation(address);
     
     operation.type = OP_WRITE_READ;
     operation.address = address;
@@ -356,12 +391,13 @@ void I2C_WriteRead(uint8_t address, const void* writeData, uint8_t writeLen, voi
 
     Start();
     
-    while (!IsDone());
+    WaitDone();
 }
 
 void I2C_WriteWithCallback(uint8_t address, WriteCallback* callback, struct WriteCallbackContext* context)
 {
     ResetBus();
+    CountOperation(address);
     
     operation.type = OP_WRITE;
     operation.address = address;
@@ -376,7 +412,7 @@ void I2C_WriteWithCallback(uint8_t address, WriteCallback* callback, struct Writ
 
     Start();
     
-    while (!IsDone());
+    WaitDone();
 }
 
 void I2C_HandleInterrupt(void)
@@ -394,3 +430,18 @@ void I2C_HandleInterrupt(void)
         HandleError();
     }
 }
+
+uint8_t I2C_GetErrorCount(void)
+{
+    return gErrorCount;
+}
+
+uint8_t I2C_GetResetCount(void)
+{
+    return gResetCount;
+}
+
+void I2C_GetDeviceStats(uint8_t device, struct I2cDeviceStats* stats)
+{
+    *stats = gDeviceStats[device];
+}
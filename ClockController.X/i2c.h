@@ -77,5 +77,25 @@ uint8_t I2C_GetErrorCount(void);
 /// @returns The cumulative reset count.
 uint8_t I2C_GetResetCount(void);
 
+// The devices on the bus, for the per-device statistics.
+#define I2C_DEVICE_NIXIE 0 ///< The Nixie drivers (0x01-0x0E) and the general call
+#define I2C_DEVICE_OLED 1
+#define I2C_DEVICE_PD 2 ///< The AP33772
+#define I2C_DEVICE_RTC 3
+#define I2C_DEVICE_OTHER 4
+#define I2C_DEVICE_COUNT 5
+
+struct I2cDeviceStats
+{
+    uint16_t operations; ///< Operations started, wrapping.
+    uint8_t errors; ///< Operations that failed, wrapping.
+};
+
+/// Gets the cumulative statistics for a device.
+///
+/// @param device One of the I2C_DEVICE_XXX values.
+/// @param stats Receives the statistics.
+void I2C_GetDeviceStats(uint8_t device, struct I2cDeviceStats* stats);
+
 #endif	/* I2C_H */
 
@@ -7,6 +7,7 @@
 #include "serial.h"
 #include "rtc.h"
 #include "gps.h"
+#include "gps_config.h"
 #include "bcd_utils.h"
 #include "ap33772.h"
 #include "timer.h"
@@ -18,15 +19,51 @@
 #include "ui.h"
 #include "time_zone.h"
 #include "nixie.h"
+#include "time_sync.h"
+#include "rtc_calibration.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "serial_benchmark.h"
+#include "diag.h"
+#include "boot.h"
+
+// Task periods, in ms. The RTC is read on every square wave edge, or polled without it.
+#define INPUT_PERIOD 5
+#define GPS_PERIOD 2
+#ifdef RTC_SQW_ENABLED
+#define RTC_PERIOD 1
+#else
+#define RTC_PERIOD 20
+#endif
+#define GPS_CHECK_PERIOD 20
+#define UI_PERIOD 50
+#define NIXIE_PERIOD 5
+#define TELEMETRY_PERIOD 1
+#define DIAG_PERIOD 200
+#define PD_PERIOD 10
 
 void __interrupt() ISR()
 {
     // Dispatch interrupts to handlers (12.9.6)
-    if (PIR1bits.SSP1IF || PIR1bits.BCL1IF) I2C_HandleInterrupt();
-    if (PIR1bits.RC1IF) GPS_HandleInterrupt();
-    if (PIR1bits.TMR2IF) TimerInterruptHandler();
-    if (PIR1bits.ADIF) AdcInterruptHandler();
-    if (PIR0bits.IOCIF) Buttons_HandleInterrupt();
+    if (PIR1bits.SSP1IF || PIR1bits.BCL1IF) PROFILE(PROFILE_I2C, I2C_HandleInterrupt());
+    if (PIR1bits.RC1IF) PROFILE(PROFILE_RC1, GPS_HandleInterrupt());
+    if (PIE1bits.TX1IE && PIR1bits.TX1IF) PROFILE(PROFILE_TX, Serial_HandleTxInterrupt());
+    if (PIR1bits.TMR2IF) PROFILE(PROFILE_TMR2, TimerInterruptHandler());
+    if (PIR1bits.TMR1IF) Timer1InterruptHandler();
+    if (PIR1bits.ADIF) PROFILE(PROFILE_ADC, AdcInterruptHandler());
+    
+    // IOCIF is the OR of the individual pin flags, so check each port's flags
+#ifdef GPS_PPS_ENABLED
+    if (IOCAF & PPS_PIN_MASK) PROFILE(PROFILE_IOC, TimeSync_HandlePpsInterrupt());
+#endif
+#ifdef RTC_SQW_ENABLED
+    if (IOCAF & RTC_SQW_PIN_MASK) PROFILE(PROFILE_IOC, RTC_HandleSqwInterrupt());
+#endif
+#ifdef AP33772_INT_ENABLED
+    if (IOCAF & AP33772_INT_PIN_MASK) PROFILE(PROFILE_IOC, AP33772_HandleInterrupt());
+#endif
+    if (IOCCF) PROFILE(PROFILE_IOC, Buttons_HandleInterrupt());
 }
 
 void EnableInterrupts()
@@ -47,28 +84,24 @@ void EnableInterrupts()
     
     // Enable the TMR2 interrupt for tick counting
     PIE1bits.TMR2IE = 1;
+    
+    // Enable the TMR1 interrupt for the microsecond timestamp
+    PIE1bits.TMR1IE = 1;
 
     // Enable ACD interrupt
     PIR1bits.ADIF = 0;
     PIE1bits.ADIE = 1;
 }
 
-void SynchronizeTime()
-{
-    struct DateTime rtcTime;
-    ConvertRtcToDateTime(&gRtc, &rtcTime);
-
-    if (!TimesAreClose(&gGpsData.datetime, &rtcTime)) RTC_Set(&gGpsData.datetime);
-}
-
 void CheckGPS()
 {
     if (gGpsData.updated)
     {
         if ('A' == gGpsData.status)
         {
+            Boot_Mark(BOOT_MILESTONE_GPS_TIME);
             GPS_ConvertToLocalTime(gTimeZoneOffset);
-            SynchronizeTime();
+            TimeSync_OnGpsTime(&gGpsData.datetime);
         }
         
         gGpsData.updated = 0;
@@ -77,6 +110,9 @@ void CheckGPS()
 
 void HandleUserInteraction()
 {
+    // Nothing to show it on yet
+    if (!Boot_DisplayReady()) return;
+    
     if (gButtonState.deltaR >= 2) UI_HandleRotationCW();
     if (gButtonState.deltaR <= -2) UI_HandleRotationCCW();
     
@@ -85,6 +121,38 @@ void HandleUserInteraction()
     gButtonState.rotation = ROTATION_NONE;
 }
 
+void GpsTask(void)
+{
+    GPS_Process();
+    TimeSync_Task();
+}
+
+void RtcTask(void)
+{
+    if (!RTC_SecondTick()) return;
+    
+    TimeSync_ReadRtc();
+    RtcCalibration_Task();
+    if (Boot_TubesLit()) UpdateNixieDrivers();
+}
+
+void GpsCheckTask(void)
+{
+    GpsConfig_Task();
+    CheckGPS();
+    
+    uint8_t config = GpsConfig_GetState();
+    if (GPS_CONFIG_STATE_OK == config || GPS_CONFIG_STATE_FAILED == config) Boot_Mark(BOOT_MILESTONE_GPS_CONFIG);
+}
+
+void UiTask(void)
+{
+    if (!Boot_DisplayReady()) return;
+    
+    UI_TickSpinner();
+    UI_Update();
+}
+
 void main(void)
 {
     InitClock();
@@ -96,51 +164,44 @@ void main(void)
     SerialInit();
     EnableInterrupts();
     
-    Buttons_Init();
+    // The timers come first, so the boot milestones are timed from here.
+    InitTimer();
+#ifdef PROFILER_ENABLED
+    Profiler_Init();
+#endif
     
-    // Give other devices (*cough*OLED*cough*) time to finish power-up.
-    __delay_ms(50);
+    Buttons_Init();
+    TimeSync_Init();
+    RTC_Init();
+    RtcCalibration_Init();
     
-    OLED_Init();
-
-#ifndef SKIP_PD
-    if (!AP33772_Init()) while (1);
+#ifdef SERIAL_BENCHMARK
+    SerialBenchmark_Run();
 #endif
     
-    InitTimer();
-    InitAdc();
-    InitPWM();
-    BoostConverter_Init();
-    
-    // Power-on can be detected as a state change in buttons. That should have stabilized at this point, so reset the
-    // edge states.
-    Button_ResetEdges();
+    gGpsData.updated = 0;
     
-    // Exercise all the Nixie cathodes on startup.
-    RefreshNixies();
+    // The OLED, USB PD contract, HV rail and tubes are brought up by Boot_Task, alongside the other tasks.
+    Boot_Init();
     
-    gGpsData.updated = 0;
+    Scheduler_AddPeriodic(&HandleUserInteraction, INPUT_PERIOD);
+    Scheduler_AddPeriodic(&GpsTask, GPS_PERIOD);
+    Scheduler_AddPeriodic(&RtcTask, RTC_PERIOD);
+    Scheduler_AddPeriodic(&GpsCheckTask, GPS_CHECK_PERIOD);
+    Scheduler_AddPeriodic(&UiTask, UI_PERIOD);
+    Scheduler_AddPeriodic(&Nixie_Task, NIXIE_PERIOD);
+#ifndef SKIP_PD
+    Scheduler_AddPeriodic(&AP33772_Task, PD_PERIOD);
+#endif
+#ifdef PROFILER_ENABLED
+    Scheduler_AddPeriodic(&Profiler_Task, 1000);
+#endif
+#ifdef TELEMETRY_ENABLED
+    Scheduler_AddPeriodic(&Telemetry_Task, TELEMETRY_PERIOD);
+#endif
+#ifdef DIAG_ENABLED
+    Scheduler_AddPeriodic(&Diag_Task, DIAG_PERIOD);
+#endif
     
-    uint8_t frameCounter = 0;
-    while (1)
-    {
-        HandleUserInteraction();
-        
-        if (frameCounter % 4 == 0)
-        {
-            RTC_Read();
-            CheckGPS();
-
-            UpdateNixieDrivers();
-        }
-
-        if (frameCounter % 10 == 0)
-        {
-            UI_TickSpinner();
-            UI_Update();
-        }
-        
-        ++frameCounter;
-        __delay_ms(5);
-    }
+    Scheduler_Run();
 }
@@ -1,9 +1,153 @@
 #include "nixie.h"
 #include "rtc.h"
 #include "i2c.h"
+#include "timer.h"
+#include "boost_control.h"
+#include "ap33772.h"
 
 uint16_t gNixieStatus = 0;
 
+// The last command sent to each driver, by address. Drivers start blank.
+#define NIXIE_ADDRESS_COUNT 0x0F
+#define NIXIE_BLANK 0x0F
+
+// Broadcast to all the drivers (I2C general call) to switch them off at once. See NixieDriver.X.
+#define NIXIE_BROADCAST_ADDRESS 0x00
+#define NIXIE_BLANK_NOW 0xFE
+static uint8_t gCommands[NIXIE_ADDRESS_COUNT] =
+{
+    NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK,
+    NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK,
+    NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK, NIXIE_BLANK
+};
+
+// The digit load fades from gFadeFrom to gDigitLoad over NIXIE_FADE_STEPS steps from gFadeStart. The comma load
+// switches from gFadeComma to gCommaLoad at the end.
+static uint8_t gDigitLoad = 0;
+static uint8_t gCommaLoad = 0;
+static uint8_t gFadeFrom = 0;
+static uint8_t gFadeComma = 0;
+static uint8_t gFadeStep = NIXIE_FADE_STEPS;
+static uint16_t gFadeStart = 0;
+
+// Set while the tubes are blanked because the HV is out of range. Commands are still tracked, but not sent.
+static uint8_t gBlanked = 0;
+
+static void PublishLoad(void)
+{
+    uint8_t digits = gDigitLoad;
+    uint8_t comma = gCommaLoad;
+    
+    if (gBlanked)
+    {
+        BoostConverter_SetExpectedLoad(0);
+        return;
+    }
+    
+    if (gFadeStep < NIXIE_FADE_STEPS)
+    {
+        digits = gFadeFrom + (uint8_t)(((int16_t)gDigitLoad - gFadeFrom) * gFadeStep / NIXIE_FADE_STEPS);
+        comma = gFadeComma;
+    }
+    
+    BoostConverter_SetExpectedLoad(digits + comma);
+}
+
+static void StartFade(void)
+{
+    gFadeStep = 0;
+    gFadeStart = Timer_GetMillis();
+    
+    PublishLoad();
+}
+
+// Updates the load estimate for a driver that is about to be sent a new command.
+static void ChangeLoad(uint8_t value, uint8_t address)
+{
+    uint8_t last = gCommands[address];
+    if (last == value) return;
+    
+    gCommands[address] = value;
+    
+    // Restart the fade from wherever the last one had got to.
+    if (gFadeStep < NIXIE_FADE_STEPS)
+    {
+        gFadeFrom += (uint8_t)(((int16_t)gDigitLoad - gFadeFrom) * gFadeStep / NIXIE_FADE_STEPS);
+    }
+    else
+    {
+        gFadeFrom = gDigitLoad;
+        gFadeComma = gCommaLoad;
+    }
+    
+    // Digits above 9 are blank, and the comma only lights with a digit.
+    if ((last & 0x0F) <= 9)
+    {
+        gDigitLoad -= NIXIE_DIGIT_LOAD;
+        if (last & 0x80) gCommaLoad -= NIXIE_COMMA_LOAD;
+    }
+    
+    if ((value & 0x0F) <= 9)
+    {
+        gDigitLoad += NIXIE_DIGIT_LOAD;
+        if (value & 0x80) gCommaLoad += NIXIE_COMMA_LOAD;
+    }
+    
+    StartFade();
+}
+
+static void SendCommand(uint8_t value, uint8_t address)
+{
+    uint8_t response = 0x8F;
+    I2C_WriteRead(address, &value, sizeof(value), &response, sizeof(response));
+    
+    if (response == value) gNixieStatus |= 1 << address;
+    else gNixieStatus &= ~(1 << address);
+}
+
+static void BlankNixies(void)
+{
+    uint8_t command = NIXIE_BLANK_NOW;
+    I2C_Write(NIXIE_BROADCAST_ADDRESS, &command, sizeof(command));
+    
+    gBlanked = 1;
+    PublishLoad();
+}
+
+// The drivers fade each digit back in, so the load comes back the same way.
+static void RestoreNixies(void)
+{
+    gBlanked = 0;
+    gFadeFrom = 0;
+    gFadeComma = 0;
+    StartFade();
+    
+    for (uint8_t address = 0; address < NIXIE_ADDRESS_COUNT; ++address)
+    {
+        if (NIXIE_BLANK != gCommands[address]) SendCommand(gCommands[address], address);
+    }
+}
+
+void Nixie_Task(void)
+{
+    // A USB PD protection event sheds the tubes' load as well.
+    uint8_t ok = BoostConverter_HvInRange();
+#ifndef SKIP_PD
+    if (AP33772_Faulted()) ok = 0;
+#endif
+    
+    if (!gBlanked && !ok) BlankNixies();
+    else if (gBlanked && ok) RestoreNixies();
+    
+    if (gFadeStep >= NIXIE_FADE_STEPS) return;
+    
+    uint16_t step = Timer_MillisSince(gFadeStart) / NIXIE_FADE_STEP_MS;
+    if (step == gFadeStep) return;
+    
+    gFadeStep = step < NIXIE_FADE_STEPS ? (uint8_t)step : NIXIE_FADE_STEPS;
+    PublishLoad();
+}
+
 uint8_t CRC(void* data, uint8_t size)
 {
     uint8_t crc = 0;
@@ -14,11 +158,11 @@ uint8_t CRC(void* data, uint8_t size)
 
 void UpdateNixieDriver(uint8_t value, uint8_t address)
 {
-    uint8_t response = 0x8F;
-    I2C_WriteRead(address, &value, sizeof(value), &response, sizeof(response));
+    // Publish the load ahead of the change, so the boost converter doesn't wait for the sag.
+    ChangeLoad(value, address);
     
-    if (response == value) gNixieStatus |= 1 << address;
-    else gNixieStatus &= ~(1 << address);
+    // While blanked, the change is sent on restore.
+    if (!gBlanked) SendCommand(value, address);
 }
 
 void UpdateNixieDrivers(void)
@@ -43,9 +187,3 @@ void UpdateNixieDrivers(void)
     UpdateNixieDriver(gRtc.year10,   0x0D);
     UpdateNixieDriver(gRtc.year01,   0x0E);
 }
-
-void RefreshNixies(void)
-{
-    for (uint8_t i = 0x01; i <= 0x06; ++i) UpdateNixieDriver(0x01, i);
-    for (uint8_t i = 0x09; i <= 0x0E; ++i) UpdateNixieDriver(0x01, i);
-}
@@ -3,11 +3,24 @@
 
 #include <xc.h>
 
+// Expected HV load per lit cathode, in the units of BoostConverter_SetExpectedLoad. There's no brightness control, so
+// a lit digit is always at full current. The comma is a much smaller cathode.
+#define NIXIE_DIGIT_LOAD 16
+#define NIXIE_COMMA_LOAD 4
+
+// The drivers cross-fade each change in 10 steps over 350ms (PWM_RAMP_STEPS and PWM_RAMP_TIME in NixieDriver.X). The
+// comma switches when the fade finishes.
+#define NIXIE_FADE_STEPS 10
+#define NIXIE_FADE_STEP_MS 35
+
 extern uint16_t gNixieStatus;
 
 void UpdateNixieDrivers(void);
 
-void RefreshNixies(void);
+/// Blanks all the tubes while the HV is out of range (see BoostConverter_HvInRange) or the AP33772 reports a fault
+/// (see AP33772_Faulted), and fades them back in when it recovers. Publishes the expected load while the drivers are
+/// cross-fading. Called every few ms.
+void Nixie_Task(void);
 
 #endif	/* NIXIE_H */
 
@@ -0,0 +1,59 @@
+#include "nvm.h"
+
+#define NVM_MEMORY_LOCATION 0x8000
+
+static void UnlockNVM(void)
+{
+    // Disable interrupts during unlock
+    INTCONbits.GIE = 0;
+    
+    // Unlock sequence (15.3.2)
+    NVMCON2 = 0x55;
+    NVMCON2 = 0xAA;
+    NVMCON1bits.WR = 1; 
+    
+    INTCONbits.GIE = 1;
+}
+
+uint16_t Nvm_Read(uint8_t word)
+{
+    // Read the memory (15.3.1)
+    NVMREGS = 1;
+    NVMADR = NVM_MEMORY_LOCATION + word;
+    NVMCON1bits.RD = 1;
+    
+    return NVMDAT;
+}
+
+void Nvm_Write(uint8_t word, uint16_t value)
+{
+    Nvm_WriteWords(word, &value, 1);
+}
+
+void Nvm_WriteWords(uint8_t first, const uint16_t* values, uint8_t count)
+{
+    uint16_t words[NVM_WORD_COUNT];
+    for (uint8_t i = 0; i < NVM_WORD_COUNT; ++i) words[i] = Nvm_Read(i);
+    for (uint8_t i = 0; i < count; ++i) words[first + i] = values[i];
+    
+    // Clear the memory (15.3.3)
+    NVMREGS = 1;
+    NVMCON1bits.FREE = 1;
+    NVMCON1bits.WREN = 1;
+    NVMADR = NVM_MEMORY_LOCATION;
+    UnlockNVM();
+    
+    // Load the write latches, then write them all with the last word (15.3.4)
+    NVMCON1bits.FREE = 0;
+    NVMCON1bits.LWLO = 1;
+    for (uint8_t i = 0; i < NVM_WORD_COUNT; ++i)
+    {
+        if (NVM_WORD_COUNT - 1 == i) NVMCON1bits.LWLO = 0;
+        
+        NVMADR = NVM_MEMORY_LOCATION + i;
+        NVMDAT = words[i];
+        UnlockNVM();
+    }
+    
+    NVMCON1bits.WREN = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef NVM_H
+#define	NVM_H
+
+#include <xc.h>
+
+// Settings are kept in the user ID words of the configuration memory. They're erased as one row, so every write goes
+// through Nvm_Write or Nvm_WriteWords, which preserve the other words.
+#define NVM_WORD_TIME_ZONE 0
+#define NVM_WORD_HV_GAIN 1
+#define NVM_WORD_HV_OFFSET 2
+#define NVM_WORD_COUNT 4
+
+///
+/// The value of an erased word. The words are 14 bits wide.
+#define NVM_EMPTY 0x3FFF
+
+///
+/// Reads a settings word (NVM_WORD_*).
+uint16_t Nvm_Read(uint8_t word);
+
+/// Writes a settings word (NVM_WORD_*), leaving the others as they were.
+/// @note This stalls the CPU for the erase and write (~5 ms).
+void Nvm_Write(uint8_t word, uint16_t value);
+
+/// Writes consecutive settings words with a single erase and write, leaving the others as they were. Settings that
+/// change together should be written this way, to save a row cycle of flash wear and stall.
+///
+/// @param first The first word to write (NVM_WORD_*).
+/// @param values The values to write from first on.
+/// @param count The number of words to write.
+/// @note This stalls the CPU for the erase and write (~5 ms).
+void Nvm_WriteWords(uint8_t first, const uint16_t* values, uint8_t count);
+
+#endif	/* NVM_H */
+
@@ -0,0 +1,58 @@
+#include "profiler.h"
+
+#ifdef PROFILER_ENABLED
+
+static struct ProfileStats gAccumulators[PROFILE_SOURCE_COUNT] = { 0 };
+static struct ProfileStats gStats[PROFILE_SOURCE_COUNT] = { 0 };
+
+void Profiler_Init(void)
+{
+    // F_osc/4 source, 1:1 pre-scaler, synchronized
+    T0CON1 = 0x40;
+    
+    // Enabled, 16-bit mode, 1:1 post-scaler
+    T0CON0 = 0x90;
+}
+
+uint16_t Profiler_Now(void)
+{
+    // Reading TMR0L latches TMR0H, so read the low byte first.
+    uint8_t lo = TMR0L;
+    return ((uint16_t)TMR0H << 8) | lo;
+}
+
+void Profiler_Record(uint8_t source, uint16_t start)
+{
+    uint16_t cycles = Profiler_Now() - start;
+    struct ProfileStats* accumulator = &gAccumulators[source];
+    
+    ++accumulator->count;
+    accumulator->cycles += cycles;
+    if (cycles > accumulator->maxCycles) accumulator->maxCycles = cycles;
+}
+
+void Profiler_Task(void)
+{
+    // The accumulators are updated by the ISR.
+    uint8_t gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    
+    for (uint8_t i = 0; i < PROFILE_SOURCE_COUNT; ++i)
+    {
+        gStats[i] = gAccumulators[i];
+        
+        gAccumulators[i].count = 0;
+        gAccumulators[i].cycles = 0;
+        gAccumulators[i].maxCycles = 0;
+    }
+    
+    INTCONbits.GIE = gie;
+}
+
+void Profiler_GetStats(uint8_t source, struct ProfileStats* stats)
+{
+    *stats = gStats[source];
+}
+
+#endif
+
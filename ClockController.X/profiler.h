@@ -0,0 +1,62 @@
+#ifndef PROFILER_H
+#define	PROFILER_H
+
+#include <xc.h>
+
+// Defining this macro times each interrupt source with TMR0 and adds a profiler page to the UI. Without it the
+// profiling macros expand to nothing.
+//#define PROFILER_ENABLED
+
+#define PROFILE_I2C 0
+#define PROFILE_RC1 1
+#define PROFILE_TMR2 2
+#define PROFILE_ADC 3
+#define PROFILE_IOC 4
+#define PROFILE_TX 5
+
+#define PROFILE_SOURCE_COUNT 6
+
+struct ProfileStats
+{
+    uint16_t count; ///< Handler calls in the last second.
+    uint32_t cycles; ///< Instruction cycles spent in the handler in the last second.
+    uint16_t maxCycles; ///< The longest single call, in instruction cycles.
+};
+
+#ifdef PROFILER_ENABLED
+
+/// Runs a statement in the ISR, charging its cycles to a source.
+///
+/// @param source One of the PROFILE_XXX values.
+#define PROFILE(source, statement) { uint16_t _start = Profiler_Now(); statement; Profiler_Record(source, _start); }
+
+///
+/// Starts TMR0 as a free-running instruction cycle counter.
+void Profiler_Init(void);
+
+///
+/// @returns The instruction cycle counter. It wraps every ~8 ms at 32 MHz.
+uint16_t Profiler_Now(void);
+
+///
+/// Called by the ISR (through PROFILE) to charge the cycles since start to a source.
+void Profiler_Record(uint8_t source, uint16_t start);
+
+///
+/// Publishes the last second of statistics. Called once per second.
+void Profiler_Task(void);
+
+/// Gets the statistics published by the last Profiler_Task.
+///
+/// @param source One of the PROFILE_XXX values.
+/// @param stats Receives the statistics.
+void Profiler_GetStats(uint8_t source, struct ProfileStats* stats);
+
+#else
+
+#define PROFILE(source, statement) statement
+
+#endif
+
+#endif	/* PROFILER_H */
+
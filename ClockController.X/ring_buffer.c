@@ -0,0 +1,39 @@
+#include "ring_buffer.h"
+
+#pragma warning disable 1510 // ignore code duplication
+uint8_t RingBuffer_Put(struct RingBuffer* ring, uint8_t data)
+{
+    uint8_t head = ring->head;
+    
+    if ((uint8_t)(head - ring->tail) > ring->mask)
+    {
+        ++ring->overruns;
+        return 0;
+    }
+    
+    ring->storage[head & ring->mask] = data;
+    
+    // Publish the byte only after it has been stored.
+    ring->head = head + 1;
+    
+    return 1;
+}
+
+uint8_t RingBuffer_Get(struct RingBuffer* ring, uint8_t* data)
+{
+    uint8_t tail = ring->tail;
+    
+    if (tail == ring->head) return 0;
+    
+    *data = ring->storage[tail & ring->mask];
+    
+    // Release the slot only after the byte has been copied out.
+    ring->tail = tail + 1;
+    
+    return 1;
+}
+
+uint8_t RingBuffer_Count(const struct RingBuffer* ring)
+{
+    return (uint8_t)(ring->head - ring->tail);
+}
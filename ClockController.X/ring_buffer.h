@@ -0,0 +1,49 @@
+#ifndef RING_BUFFER_H
+#define	RING_BUFFER_H
+
+#include <xc.h>
+
+/*
+ * A lock-free, single-producer/single-consumer byte queue.
+ *
+ * The producer only ever writes `head` and the consumer only ever writes `tail`. Both are single bytes, so accesses are
+ * atomic on this core and one side may run in the interrupt context without masking interrupts on the other.
+ */
+
+///
+/// Holds the state of a ring buffer. Initialize with RING_BUFFER_INIT.
+struct RingBuffer
+{
+    uint8_t* storage; ///< The backing storage. The size must be a power of two, no larger than 128 bytes.
+    uint8_t mask; ///< The size of the storage, minus one.
+
+    volatile uint8_t head; ///< Free-running count of bytes written. Only modified by the producer.
+    volatile uint8_t tail; ///< Free-running count of bytes read. Only modified by the consumer.
+
+    volatile uint8_t overruns; ///< The cumulative count of bytes dropped because the ring was full.
+};
+
+///
+/// Static initializer for a ring buffer backed by the array `storage`.
+#define RING_BUFFER_INIT(storage) { storage, sizeof(storage) - 1, 0, 0, 0 }
+
+/// Adds a byte to the ring. Must only be called by the producer.
+///
+/// @param ring The ring to add to.
+/// @param data The byte to add.
+/// @returns 1 on success, 0 if the ring was full and the byte was dropped.
+uint8_t RingBuffer_Put(struct RingBuffer* ring, uint8_t data);
+
+/// Removes a byte from the ring. Must only be called by the consumer.
+///
+/// @param ring The ring to remove from.
+/// @param data Receives the byte removed.
+/// @returns 1 on success, 0 if the ring was empty.
+uint8_t RingBuffer_Get(struct RingBuffer* ring, uint8_t* data);
+
+///
+/// @returns The number of bytes waiting in the ring.
+uint8_t RingBuffer_Count(const struct RingBuffer* ring);
+
+#endif	/* RING_BUFFER_H */
+
@@ -1,22 +1,155 @@
 #include "rtc.h"
 #include "i2c.h"
+#include "timer.h"
 
 struct RtcData gRtc;
+struct DateTime gRtcDateTime;
+
+// Set when the registers past seconds have to be read again.
+static uint8_t gFullReadNeeded = 1;
+static uint8_t gLastBusErrors = 0;
+
+// Bus errors and resets both mean the cached registers may not be what the RTC holds.
+static uint8_t GetBusErrors(void)
+{
+    return I2C_GetErrorCount() + I2C_GetResetCount();
+}
+
+#ifdef RTC_SQW_ENABLED
+static volatile uint32_t gSqwTime = 0;
+static volatile uint8_t gSqwCount = 0;
+static volatile uint8_t gTick = 1;
+#endif
+
+void RTC_Init(void)
+{
+#ifdef RTC_SQW_ENABLED
+    // RA0 is a digital input with a pull-up for the open-drain output, interrupting on the falling edge (17.3)
+    TRISA |= RTC_SQW_PIN_MASK;
+    WPUA |= RTC_SQW_PIN_MASK;
+    IOCAN |= RTC_SQW_PIN_MASK;
+    
+    // Clearing INTCN routes the square wave to the pin; RS = 0 selects 1 Hz.
+    uint8_t control[] = { RTC_CONTROL_ADDRESS, RTC_CONTROL_RS_1HZ };
+    I2C_Write(I2C_RTC_ADDRESS, control, sizeof(control));
+#endif
+}
+
+void RTC_HandleSqwInterrupt(void)
+{
+#ifdef RTC_SQW_ENABLED
+    IOCAF &= ~RTC_SQW_PIN_MASK;
+    
+    gSqwTime = Timer_GetMicros();
+    ++gSqwCount;
+    gTick = 1;
+#endif
+}
+
+uint8_t RTC_SecondTick(void)
+{
+#ifdef RTC_SQW_ENABLED
+    if (!gTick) return 0;
+    
+    gTick = 0;
+#endif
+    return 1;
+}
+
+uint32_t RTC_GetTickTime(void)
+{
+#ifdef RTC_SQW_ENABLED
+    uint8_t count;
+    uint32_t time;
+    do
+    {
+        count = gSqwCount;
+        time = gSqwTime;
+    }
+    while (count != gSqwCount);
+    
+    return time;
+#else
+    return 0;
+#endif
+}
 
 void RTC_Read()
 {
     uint8_t READ_START_ADDRESS = 0x00;
+    
+    if (!gFullReadNeeded)
+    {
+        // Only the seconds register changes between minutes.
+        uint8_t lastSecond = gRtcDateTime.second;
+        I2C_WriteRead(I2C_RTC_ADDRESS, &READ_START_ADDRESS, sizeof(READ_START_ADDRESS), &gRtc, 1);
+        gRtcDateTime.second = gRtc.second10 * 10 + gRtc.second01;
+        
+        // Read the rest when the minute rolls over (even if 00 was missed) or the bus had trouble.
+        gFullReadNeeded = gRtcDateTime.second < lastSecond || GetBusErrors() != gLastBusErrors;
+    }
+
+    if (gFullReadNeeded)
+    {
+        uint8_t busErrors = GetBusErrors();
+        
+        I2C_WriteRead(I2C_RTC_ADDRESS, &READ_START_ADDRESS, sizeof(READ_START_ADDRESS), &gRtc, sizeof(gRtc));
+        ConvertRtcToDateTime(&gRtc, &gRtcDateTime);
+        
+        // Try again next time if this read had trouble too.
+        gLastBusErrors = GetBusErrors();
+        gFullReadNeeded = busErrors != gLastBusErrors;
+    }
+}
+
+int8_t RTC_ReadAgingOffset(void)
+{
+    uint8_t address = RTC_AGING_ADDRESS;
+    int8_t offset = 0;
+    
+    I2C_WriteRead(I2C_RTC_ADDRESS, &address, sizeof(address), &offset, sizeof(offset));
+    
+    return offset;
+}
 
-    I2C_WriteRead(I2C_RTC_ADDRESS, &READ_START_ADDRESS, sizeof(READ_START_ADDRESS), &gRtc, sizeof(gRtc));
+void RTC_WriteAgingOffset(int8_t offset)
+{
+    uint8_t aging[] = { RTC_AGING_ADDRESS, (uint8_t)offset };
+    I2C_Write(I2C_RTC_ADDRESS, aging, sizeof(aging));
 }
 
-void RTC_Set(volatile struct DateTime* dt)
+uint8_t RTC_StartConversion(void)
+{
+    // The datasheet requires BSY to be clear before CONV is set. Assume busy if the read fails.
+    uint8_t address = RTC_STATUS_ADDRESS;
+    uint8_t status = RTC_STATUS_BSY;
+    I2C_WriteRead(I2C_RTC_ADDRESS, &address, sizeof(address), &status, sizeof(status));
+    
+    if (status & RTC_STATUS_BSY) return 0;
+    
+    uint8_t control[] = { RTC_CONTROL_ADDRESS, 0 };
+    I2C_WriteRead(I2C_RTC_ADDRESS, control, 1, control + 1, 1);
+    
+    control[1] |= RTC_CONTROL_CONV;
+    I2C_Write(I2C_RTC_ADDRESS, control, sizeof(control));
+    
+    return 1;
+}
+
+void RTC_Set(const volatile struct DateTime* dt)
 {
     // Byte 0 is the starting register address for the write.
     uint8_t buffer[sizeof(struct RtcData) + 1] = { 0 };
     ConvertDateTimeToRtc((struct RtcData*)(buffer + 1), dt, HOUR_TYPE_24);
     
     I2C_Write(I2C_RTC_ADDRESS, buffer, sizeof(buffer));
+    
+    gFullReadNeeded = 1;
+
+#ifdef RTC_SQW_ENABLED
+    // The write restarts the second, so there won't be an edge for a while. Pick up the new time now.
+    gTick = 1;
+#endif
 }
 
 void ConvertRtcToDateTime(const volatile struct RtcData* rtc, volatile struct DateTime* datetime)
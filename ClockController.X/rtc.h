@@ -7,6 +7,27 @@
 
 #define I2C_RTC_ADDRESS 0x68
 
+// Defining this macro enables the DS3231 1 Hz square wave on RA0 (the ICSPDAT pin, wired to INT/SQW). The RTC is then
+// read once per second, on the edge, instead of being polled. The aging offset calibration needs it (see
+// rtc_calibration.h).
+//#define RTC_SQW_ENABLED
+
+// The square wave pin, RA0
+#define RTC_SQW_PIN_MASK 0x01
+
+// Control register (0x0E) bits
+#define RTC_CONTROL_ADDRESS 0x0E
+#define RTC_CONTROL_INTCN 0x04
+#define RTC_CONTROL_RS_1HZ 0x00
+#define RTC_CONTROL_CONV 0x20
+
+// Status register (0x0F) bits
+#define RTC_STATUS_ADDRESS 0x0F
+#define RTC_STATUS_BSY 0x04
+
+// Aging offset register. Signed, roughly 0.1 ppm per LSB; positive values slow the oscillator.
+#define RTC_AGING_ADDRESS 0x10
+
 #define HOUR_TYPE_12 1
 #define HOUR_TYPE_24 0
 
@@ -50,9 +71,46 @@ struct RtcData
 
 extern struct RtcData gRtc;
 
+///
+/// The time last read from the RTC, decoded.
+extern struct DateTime gRtcDateTime;
+
+///
+/// Configures the square wave output and its input pin, if enabled.
+void RTC_Init(void);
+
+///
+/// Called by the ISR on the falling edge of the square wave, which is when the seconds roll over.
+void RTC_HandleSqwInterrupt(void);
+
+///
+/// True once after each square wave edge or RTC_Set. Always true without the square wave.
+uint8_t RTC_SecondTick(void);
+
+///
+/// The Timer_GetMicros timestamp of the last square wave edge.
+uint32_t RTC_GetTickTime(void);
+
+/// Reads the RTC into gRtc and gRtcDateTime.
+///
+/// @note Normally only the seconds register is read. The rest are read when the seconds roll over, after RTC_Set, or
+/// after an I2C error.
 void RTC_Read(void);
 
-void RTC_Set(volatile struct DateTime* dt);
+///
+/// Reads the aging offset register.
+int8_t RTC_ReadAgingOffset(void);
+
+///
+/// Writes the aging offset register. It takes effect at the next temperature conversion (see RTC_StartConversion).
+void RTC_WriteAgingOffset(int8_t offset);
+
+/// Starts a temperature conversion, which also applies the aging offset, unless one is already running.
+///
+/// @returns 1 if the conversion was started, 0 if the RTC was busy (BSY) and the caller should try again later.
+uint8_t RTC_StartConversion(void);
+
+void RTC_Set(const volatile struct DateTime* dt);
 
 void ConvertRtcToDateTime(const volatile struct RtcData* rtc, volatile struct DateTime* datetime);
 
@@ -0,0 +1,121 @@
+#include "rtc_calibration.h"
+#include "rtc.h"
+#include "time_sync.h"
+#include "timer.h"
+
+// Phase samples less certain than this are too coarse to measure drift with. The square wave edge gets well under it,
+// but polled reads every RTC_PERIOD only narrow the phase to a few hundred s, so without RTC_SQW_ENABLED the
+// calibration is compiled out rather than left waiting for samples that never come.
+#define MAX_UNCERTAINTY_US 100
+
+// A measurement ends after this many seconds, or earlier once MIN_DRIFT_US has accumulated (so it completes before
+// the time sync rewrites the RTC). The maximum must stay below the ~71 minute wrap of Timer_GetMicros.
+#define MIN_INTERVAL_S 60
+#define MAX_INTERVAL_S 3600
+#define MIN_DRIFT_US 250
+
+// Largest aging offset change made from a single measurement.
+#define MAX_STEP 10
+
+// Anything beyond this (in 0.01 ppm) is a phase jump rather than drift. The DS3231 is rated for 2 ppm.
+#define MAX_DRIFT 5000
+
+static int8_t gAgingOffset = 0;
+static int16_t gDrift = RTC_DRIFT_UNKNOWN;
+static uint8_t gAdjustments = 0;
+
+#ifdef RTC_SQW_ENABLED
+// Set when a new aging offset is waiting for a temperature conversion to apply it.
+static uint8_t gConversionPending = 0;
+
+static uint8_t gMeasuring = 0;
+static int32_t gStartPhase;
+static uint32_t gStartTime;
+static uint8_t gStartWrites;
+#endif
+
+void RtcCalibration_Init(void)
+{
+    gAgingOffset = RTC_ReadAgingOffset();
+}
+
+void RtcCalibration_Task(void)
+{
+#ifdef RTC_SQW_ENABLED
+    int32_t phase;
+    uint16_t uncertainty;
+    
+    if (gConversionPending && RTC_StartConversion()) gConversionPending = 0;
+    
+    if (!TimeSync_GetPhaseMicros(&phase, &uncertainty) || uncertainty > MAX_UNCERTAINTY_US)
+    {
+        gMeasuring = 0;
+        return;
+    }
+    
+    uint32_t now = Timer_GetMicros();
+    
+    // A rewrite moves the phase, so the measurement has to start over.
+    if (!gMeasuring || gStartWrites != TimeSync_GetWriteCount())
+    {
+        gStartPhase = phase;
+        gStartTime = now;
+        gStartWrites = TimeSync_GetWriteCount();
+        gMeasuring = 1;
+        return;
+    }
+    
+    int32_t drift = phase - gStartPhase;
+    int16_t seconds = (int16_t)((now - gStartTime) / 1000000ul);
+    
+    if (seconds < MIN_INTERVAL_S) return;
+    if (seconds < MAX_INTERVAL_S && drift < MIN_DRIFT_US && drift > -MIN_DRIFT_US) return;
+    
+    // s of phase per second is ppm.
+    int32_t rate = drift * 100 / seconds;
+    if (rate > MAX_DRIFT || rate < -MAX_DRIFT)
+    {
+        gMeasuring = 0;
+        return;
+    }
+    
+    gDrift = (int16_t)rate;
+    
+    // A slow RTC (growing lag) needs a smaller aging offset. Round toward zero so noise doesn't cause hunting.
+    int16_t step = gDrift / 10;
+    if (step > MAX_STEP) step = MAX_STEP;
+    if (step < -MAX_STEP) step = -MAX_STEP;
+    
+    int16_t offset = gAgingOffset - step;
+    if (offset > INT8_MAX) offset = INT8_MAX;
+    if (offset < INT8_MIN) offset = INT8_MIN;
+    
+    if (offset != gAgingOffset)
+    {
+        gAgingOffset = (int8_t)offset;
+        RTC_WriteAgingOffset(gAgingOffset);
+        gConversionPending = !RTC_StartConversion();
+        ++gAdjustments;
+    }
+    
+    // Measure again from here.
+    gStartPhase = phase;
+    gStartTime = now;
+#endif
+}
+
+int16_t RtcCalibration_GetDrift(void)
+{
+    return gDrift;
+}
+
+int8_t RtcCalibration_GetAgingOffset(void)
+{
+    return gAgingOffset;
+}
+
+uint8_t RtcCalibration_GetAdjustmentCount(void)
+{
+    return gAdjustments;
+}
+
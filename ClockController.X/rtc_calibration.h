@@ -0,0 +1,34 @@
+#ifndef RTC_CALIBRATION_H
+#define	RTC_CALIBRATION_H
+
+#include <xc.h>
+
+///
+/// Returned by RtcCalibration_GetDrift before the first measurement completes.
+#define RTC_DRIFT_UNKNOWN INT16_MIN
+
+///
+/// Reads the current aging offset from the RTC.
+void RtcCalibration_Init(void);
+
+/// Tracks the RTC phase against PPS and trims the DS3231 aging offset when enough drift has accumulated. Called from
+/// RtcTask after each RTC read: once per second with RTC_SQW_ENABLED, otherwise every RTC_PERIOD.
+///
+/// @note This does nothing without both GPS_PPS_ENABLED and RTC_SQW_ENABLED. Polled reads only place the RTC second
+///       to within a few hundred s of the PPS edge, which is too coarse to measure drift with.
+void RtcCalibration_Task(void);
+
+///
+/// The last measured RTC frequency error in 0.01 ppm units. Positive values mean the RTC runs slow.
+int16_t RtcCalibration_GetDrift(void);
+
+///
+/// The aging offset currently programmed in the RTC.
+int8_t RtcCalibration_GetAgingOffset(void);
+
+///
+/// Free-running count of aging offset adjustments.
+uint8_t RtcCalibration_GetAdjustmentCount(void);
+
+#endif	/* RTC_CALIBRATION_H */
+
@@ -0,0 +1,120 @@
+#include "scheduler.h"
+#include "timer.h"
+
+// How often the idle percentage is updated, in ms.
+#define IDLE_WINDOW 1000
+
+struct Task
+{
+    SchedulerTaskFunction* function; ///< NULL if the slot is free.
+    uint16_t period; ///< 0 for one-shot tasks.
+    uint16_t deadline;
+};
+
+static struct Task gTasks[SCHEDULER_MAX_TASKS] = { 0 };
+
+static uint8_t gIdlePct = 0;
+static uint8_t gOverruns = 0;
+
+static uint8_t AddTask(SchedulerTaskFunction* function, uint16_t period, uint16_t delay)
+{
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; ++i)
+    {
+        if (NULL != gTasks[i].function) continue;
+        
+        gTasks[i].period = period;
+        gTasks[i].deadline = Timer_GetMillis() + delay;
+        gTasks[i].function = function;
+        
+        return i;
+    }
+    
+    return SCHEDULER_NO_TASK;
+}
+
+uint8_t Scheduler_AddPeriodic(SchedulerTaskFunction* function, uint16_t period)
+{
+    return AddTask(function, period, period);
+}
+
+uint8_t Scheduler_AddOneShot(SchedulerTaskFunction* function, uint16_t delay)
+{
+    return AddTask(function, 0, delay);
+}
+
+void Scheduler_Cancel(uint8_t id)
+{
+    if (id < SCHEDULER_MAX_TASKS) gTasks[id].function = NULL;
+}
+
+void Scheduler_Run(void)
+{
+    uint16_t windowStart = Timer_GetMillis();
+    uint32_t idleMicros = 0;
+    
+    while (1)
+    {
+        uint16_t now = Timer_GetMillis();
+        uint16_t next = now + INT16_MAX;
+        
+        for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; ++i)
+        {
+            struct Task* task = &gTasks[i];
+            SchedulerTaskFunction* function = task->function;
+            
+            if (NULL == function) continue;
+            
+            if (TIMER_DUE(task->deadline, now))
+            {
+                if (0 == task->period)
+                {
+                    task->function = NULL;
+                }
+                else if (TIMER_ELAPSED(task->deadline, now) >= task->period)
+                {
+                    // A whole period was missed. Skip ahead rather than running the task back-to-back to catch up.
+                    ++gOverruns;
+                    task->deadline = now + task->period;
+                }
+                else
+                {
+                    // Advancing from the deadline (not from now) keeps the period from drifting.
+                    task->deadline += task->period;
+                }
+                
+                function();
+                now = Timer_GetMillis();
+            }
+            
+            if (NULL != task->function && (int16_t)(task->deadline - next) < 0) next = task->deadline;
+        }
+        
+        // Nothing more is due until the next deadline.
+        if (!TIMER_DUE(next, now))
+        {
+            uint32_t idleStart = Timer_GetMicros();
+            while (!TIMER_DUE(next, Timer_GetMillis()));
+            idleMicros += Timer_MicrosSince(idleStart);
+        }
+        
+        now = Timer_GetMillis();
+        uint16_t window = TIMER_ELAPSED(windowStart, now);
+        if (window >= IDLE_WINDOW)
+        {
+            gIdlePct = (uint8_t)(idleMicros / (window * 10ul));
+            idleMicros = 0;
+            windowStart = now;
+        }
+    }
+}
+
+uint8_t Scheduler_GetIdlePct(void)
+{
+    return gIdlePct;
+}
+
+uint8_t Scheduler_GetOverrunCount(void)
+{
+    return gOverruns;
+}
+
@@ -0,0 +1,48 @@
+#ifndef SCHEDULER_H
+#define	SCHEDULER_H
+
+#include <xc.h>
+
+// Room for the optional profiler, telemetry and diagnostic tasks as well as the main ones.
+#define SCHEDULER_MAX_TASKS 11
+
+///
+/// Returned in place of a task ID when the task table is full.
+#define SCHEDULER_NO_TASK 0xFF
+
+typedef void (SchedulerTaskFunction)(void);
+
+/// Adds a task that runs every period milliseconds, starting one period from now.
+///
+/// @param function The task function. Tasks run to completion, so they should return quickly.
+/// @param period The period in milliseconds [1..32767].
+/// @returns The task ID, or SCHEDULER_NO_TASK.
+uint8_t Scheduler_AddPeriodic(SchedulerTaskFunction* function, uint16_t period);
+
+/// Adds a task that runs once, delay milliseconds from now.
+///
+/// @param function The task function.
+/// @param delay The delay in milliseconds [0..32767].
+/// @returns The task ID, or SCHEDULER_NO_TASK.
+uint8_t Scheduler_AddOneShot(SchedulerTaskFunction* function, uint16_t delay);
+
+///
+/// Removes a task. Cancelling a one-shot task that already ran has no effect.
+void Scheduler_Cancel(uint8_t id);
+
+///
+/// Runs due tasks in the order they were added, idling until the next deadline in between. Never returns.
+void Scheduler_Run(void);
+
+/// Gets the share of time spent waiting for a deadline. Interrupts taken during the wait count as idle, so with
+/// PROFILER_ENABLED their share is on the profiler page instead.
+///
+/// @returns The percentage of the last second spent waiting for a deadline.
+uint8_t Scheduler_GetIdlePct(void);
+
+///
+/// @returns Free-running count of periodic tasks that started a full period late.
+uint8_t Scheduler_GetOverrunCount(void);
+
+#endif	/* SCHEDULER_H */
+
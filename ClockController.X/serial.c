@@ -1,17 +1,94 @@
 #include "serial.h"
 #include "clock.h"
+#include "ring_buffer.h"
 #include <xc.h>
 
-#define SER_BAUD (9600ul)
+static uint8_t gTxStorage[SERIAL_TX_BUFFER_SIZE];
+static struct RingBuffer gTxRing = RING_BUFFER_INIT(gTxStorage);
+
+// Only updated by the main loop.
+static uint16_t gDroppedWrites = 0;
+static uint16_t gDroppedBytes = 0;
 
 void SerialInit(void)
 {
-    //TX9D 0x0; BRGH hi_speed; SENDB sync_break_complete; SYNC asynchronous; TX9 8-bit; CSRC client; (24.6.1)
-    TX1STA = 0x06;
+    //TX9D 0x0; BRGH hi_speed; SENDB sync_break_complete; SYNC asynchronous; TXEN enabled; TX9 8-bit; CSRC client; (24.6.1)
+    TX1STA = 0x26;
     //ABDEN disabled; WUE disabled; BRG16 16bit_generator; SCKP Non-Inverted;  (24.6.3)
     BAUD1CON = 0x48;
     //ADDEN disabled; CREN enabled; SREN disabled; RX9 8-bit; SPEN enabled; (24.6.2)
     RC1STA = 0x90;
-    //SPBRGL 103; SPBRGH 0; (24.6.6)
-    SP1BRG = _XTAL_FREQ / (4 * SER_BAUD) - 1; 
+    
+    Serial_SetBaud(SERIAL_DEFAULT_BAUD);
+}
+
+void Serial_SetBaud(uint32_t baud)
+{
+    Serial_Flush();
+    
+    // 16-bit generator with BRGH set (24.3, Table 24-3)
+    SP1BRG = (uint16_t)(_XTAL_FREQ / (4 * baud) - 1);
+}
+
+void Serial_Write(const void* data, uint8_t len)
+{
+    const uint8_t* bytes = data;
+    
+    while (len--)
+    {
+        // The ISR makes room.
+        while (!Serial_TxFree());
+        RingBuffer_Put(&gTxRing, *(bytes++));
+        
+        PIE1bits.TX1IE = 1;
+    }
+}
+
+uint8_t Serial_Queue(const void* data, uint8_t len)
+{
+    if (len > Serial_TxFree())
+    {
+        ++gDroppedWrites;
+        gDroppedBytes += len;
+        
+        return 0;
+    }
+    
+    const uint8_t* bytes = data;
+    while (len--) RingBuffer_Put(&gTxRing, *(bytes++));
+    
+    PIE1bits.TX1IE = 1;
+    return 1;
+}
+
+uint8_t Serial_TxFree(void)
+{
+    return SERIAL_TX_BUFFER_SIZE - RingBuffer_Count(&gTxRing);
+}
+
+void Serial_Flush(void)
+{
+    while (RingBuffer_Count(&gTxRing));
+    
+    // TRMT is set once the TSR is empty (24.1.1.4)
+    while (!TX1STAbits.TRMT);
+}
+
+void Serial_HandleTxInterrupt(void)
+{
+    // TX1IF is set while TX1REG is empty, and can't be cleared in software (24.1.1.3). Masking the interrupt is the
+    // only way to stop it once the ring runs dry.
+    uint8_t data;
+    if (RingBuffer_Get(&gTxRing, &data)) TX1REG = data;
+    else PIE1bits.TX1IE = 0;
+}
+
+uint16_t Serial_GetDroppedWrites(void)
+{
+    return gDroppedWrites;
+}
+
+uint16_t Serial_GetDroppedBytes(void)
+{
+    return gDroppedBytes;
 }
@@ -1,7 +1,64 @@
 #ifndef SERIAL_H
 #define	SERIAL_H
 
+#include <xc.h>
+
+///
+/// The baud rate the EUSART starts at. This is the NEO-6M default.
+#define SERIAL_DEFAULT_BAUD (9600ul)
+
+///
+/// Initializes the EUSART for asynchronous receive and transmit at SERIAL_DEFAULT_BAUD.
 void SerialInit(void);
 
+/// Changes the EUSART baud rate. Anything queued is sent at the old rate first.
+///
+/// @param baud The new baud rate.
+/// @note Any byte being received while the rate changes will likely be lost to a framing error.
+void Serial_SetBaud(uint32_t baud);
+
+/*
+ * Transmission is interrupt driven: writes are queued in a ring and the TX1IF interrupt feeds the EUSART from it, so
+ * the main loop only waits when the ring is full.
+ */
+
+///
+/// The size of the transmit ring, in bytes. Must be a power of two, no larger than 128.
+#define SERIAL_TX_BUFFER_SIZE 64
+
+/// Queues data for transmission.
+///
+/// @param data A pointer to the data to send.
+/// @param len The length of the data, in bytes.
+/// @NOTE This call blocks until the last byte has been queued, which is only a wait if the ring is full.
+void Serial_Write(const void* data, uint8_t len);
+
+/// Queues data for transmission without blocking. The data is queued whole or not at all.
+///
+/// @param data A pointer to the data to send.
+/// @param len The length of the data, in bytes.
+/// @returns 1 on success, 0 if there wasn't room and the data was dropped.
+uint8_t Serial_Queue(const void* data, uint8_t len);
+
+///
+/// @returns The number of bytes that can be queued without blocking.
+uint8_t Serial_TxFree(void);
+
+///
+/// Blocks until everything queued has been sent and the transmit shift register is empty.
+void Serial_Flush(void);
+
+///
+/// Called by the ISR when TX1IF is set and the transmit interrupt is enabled.
+void Serial_HandleTxInterrupt(void);
+
+///
+/// @returns The cumulative count of Serial_Queue calls that dropped their data.
+uint16_t Serial_GetDroppedWrites(void);
+
+///
+/// @returns The cumulative count of bytes dropped by Serial_Queue.
+uint16_t Serial_GetDroppedBytes(void);
+
 #endif	/* SERIAL_H */
 
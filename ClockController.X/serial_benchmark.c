@@ -0,0 +1,136 @@
+#include "serial_benchmark.h"
+#include "serial.h"
+#include "timer.h"
+#include "clock.h"
+
+#ifdef SERIAL_BENCHMARK
+
+#define BENCH_BYTES 256
+#define BENCH_PATTERN 0x55
+
+#define CYCLES_PER_US (_XTAL_FREQ / 4 / 1000000ul)
+
+static const uint32_t BENCH_BAUDS[] = { 9600ul, 57600ul, 115200ul };
+#define BENCH_RATES (sizeof(BENCH_BAUDS) / sizeof(BENCH_BAUDS[0]))
+
+struct BenchResult
+{
+    uint32_t transferUs;
+    uint32_t polledCycles;
+    uint32_t ringCycles;
+};
+
+static struct BenchResult gResults[BENCH_RATES];
+
+// Sends the block the way the polled driver did. The main loop does nothing else until it has gone.
+static uint32_t SendPolled(void)
+{
+    uint32_t start = Timer_GetMicros();
+    
+    for (uint16_t i = 0; i < BENCH_BYTES; ++i)
+    {
+        while (!PIR1bits.TX1IF);
+        TX1REG = BENCH_PATTERN;
+    }
+    
+    while (!TX1STAbits.TRMT);
+    
+    return Timer_MicrosSince(start);
+}
+
+// A main loop that queues up to bytes a byte at a time and otherwise idles, for windowUs. Returns the idle iterations.
+static uint32_t Spin(uint16_t bytes, uint32_t windowUs)
+{
+    uint16_t queued = 0;
+    uint32_t idle = 0;
+    uint32_t start = Timer_GetMicros();
+    
+    while (Timer_MicrosSince(start) < windowUs)
+    {
+        if (queued < bytes && Serial_TxFree())
+        {
+            uint8_t data = BENCH_PATTERN;
+            Serial_Queue(&data, sizeof(data));
+            ++queued;
+        }
+        else
+        {
+            ++idle;
+        }
+    }
+    
+    Serial_Flush();
+    
+    return idle;
+}
+
+static void Measure(uint32_t baud, struct BenchResult* result)
+{
+    Serial_SetBaud(baud);
+    
+    result->transferUs = SendPolled();
+    result->polledCycles = result->transferUs * CYCLES_PER_US;
+    
+    // Give the ring time to drain, so the window covers the whole transfer.
+    uint32_t windowUs = result->transferUs + result->transferUs / 4;
+    uint32_t idleBase = Spin(0, windowUs);
+    uint32_t idle = Spin(BENCH_BYTES, windowUs);
+    
+    // The cycles per idle iteration, with 4 fractional bits.
+    uint32_t iterationCycles = ((windowUs * CYCLES_PER_US) << 4) / idleBase;
+    result->ringCycles = idle < idleBase ? ((idleBase - idle) * iterationCycles) >> 4 : 0;
+}
+
+static uint8_t AppendString(char* line, uint8_t pos, const char* text)
+{
+    while (*text) line[pos++] = *(text++);
+    return pos;
+}
+
+static uint8_t AppendNumber(char* line, uint8_t pos, uint32_t value)
+{
+    char digits[10];
+    uint8_t count = 0;
+    
+    do
+    {
+        digits[count++] = '0' + (char)(value % 10);
+        value /= 10;
+    }
+    while (value);
+    
+    while (count) line[pos++] = digits[--count];
+    return pos;
+}
+
+static void Report(uint32_t baud, const struct BenchResult* result)
+{
+    char line[80];
+    uint8_t pos = 0;
+    
+    pos = AppendString(line, pos, "TX ");
+    pos = AppendNumber(line, pos, baud);
+    pos = AppendString(line, pos, ": ");
+    pos = AppendNumber(line, pos, BENCH_BYTES);
+    pos = AppendString(line, pos, " bytes in ");
+    pos = AppendNumber(line, pos, result->transferUs);
+    pos = AppendString(line, pos, " us, polled ");
+    pos = AppendNumber(line, pos, result->polledCycles);
+    pos = AppendString(line, pos, " cycles, ring ");
+    pos = AppendNumber(line, pos, result->ringCycles);
+    pos = AppendString(line, pos, " cycles\r\n");
+    
+    Serial_Write(line, pos);
+}
+
+void SerialBenchmark_Run(void)
+{
+    for (uint8_t i = 0; i < BENCH_RATES; ++i) Measure(BENCH_BAUDS[i], &gResults[i]);
+    
+    Serial_SetBaud(SERIAL_DEFAULT_BAUD);
+    for (uint8_t i = 0; i < BENCH_RATES; ++i) Report(BENCH_BAUDS[i], &gResults[i]);
+    
+    Serial_Flush();
+}
+
+#endif
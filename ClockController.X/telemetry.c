@@ -0,0 +1,157 @@
+#include "telemetry.h"
+#include "gps_config.h"
+#include "diag.h"
+#include "adc.h"
+#include "timer.h"
+
+#ifdef TELEMETRY_ENABLED
+
+#if TELEMETRY_SAMPLES & (TELEMETRY_SAMPLES - 1)
+#error TELEMETRY_SAMPLES must be a power of two
+#endif
+
+#define TELEMETRY_MASK (TELEMETRY_SAMPLES - 1)
+
+#define STATE_ARMED 0
+#define STATE_TRIGGERED 1
+#define STATE_FROZEN 2
+#define STATE_SENDING 3
+
+// The whole record is counted with a byte.
+#define RECORD_SIZE(count) (TELEMETRY_HEADER_SIZE + (count) * TELEMETRY_SAMPLE_SIZE)
+
+#if RECORD_SIZE(TELEMETRY_SAMPLES) > 255
+#error TELEMETRY_SAMPLES is too large for a frame
+#endif
+
+static uint8_t gSamples[TELEMETRY_SAMPLES][TELEMETRY_SAMPLE_SIZE];
+
+// Written by the ISR while capturing, and by the main loop while frozen or sending.
+static volatile uint8_t gState = STATE_ARMED;
+static uint8_t gHead = 0;
+static uint8_t gFilled = 0;
+static uint8_t gPostTrigger = 0;
+static uint8_t gEvent = TELEMETRY_EVENT_NONE;
+
+// Decimation state. Events are collected over the skipped updates so a single-update OVP isn't lost.
+static uint8_t gDecimation = 0;
+static uint8_t gEvents = 0;
+static uint8_t gLastEvents = 0;
+
+// The record being sent.
+static uint8_t gHeader[TELEMETRY_HEADER_SIZE];
+static uint8_t gSendPos = 0;
+static uint8_t gSendSize = 0;
+
+void Telemetry_Record(uint16_t cv, uint16_t dutyCycle, uint8_t events)
+{
+    uint8_t state = gState;
+    if (STATE_FROZEN == state || STATE_SENDING == state) return;
+    
+    gEvents |= events;
+    if (++gDecimation < TELEMETRY_DECIMATION) return;
+    gDecimation = 0;
+    
+    events = gEvents;
+    gEvents = 0;
+    
+    uint16_t adc = cv >> (ADC_FRACTION_BITS - 2);
+    uint8_t* sample = gSamples[gHead];
+    sample[0] = (uint8_t)adc;
+    sample[1] = (uint8_t)((adc >> 8) & 0x0F) | (uint8_t)(dutyCycle << 4);
+    sample[2] = (uint8_t)((dutyCycle >> 4) & 0x3F) | (uint8_t)(events << 6);
+    
+    gHead = (gHead + 1) & TELEMETRY_MASK;
+    if (gFilled < TELEMETRY_SAMPLES) ++gFilled;
+    
+    if (STATE_TRIGGERED == state)
+    {
+        if (!--gPostTrigger) gState = STATE_FROZEN;
+        return;
+    }
+    
+#if TELEMETRY_TRIGGERS
+    // Only the start of an event triggers, so a long excursion doesn't trigger again once re-armed.
+    uint8_t rising = events & ~gLastEvents;
+    gLastEvents = events;
+    
+    if (rising & TELEMETRY_TRIGGERS)
+    {
+        gEvent = rising & TELEMETRY_TRIGGERS;
+        gPostTrigger = TELEMETRY_POST_TRIGGER;
+        gState = STATE_TRIGGERED;
+    }
+#else
+    if (TELEMETRY_SAMPLES == gFilled) gState = STATE_FROZEN;
+#endif
+}
+
+static uint8_t StartRecord(void)
+{
+    if (!Diag_BeginFrame(DIAG_RECORD_TELEMETRY)) return 0;
+    
+    uint8_t count = gFilled;
+    uint8_t trigger = TELEMETRY_NO_TRIGGER;
+    if (TELEMETRY_EVENT_NONE != gEvent) trigger = count - 1 - TELEMETRY_POST_TRIGGER;
+    
+    uint16_t periodUs = (uint16_t)(TELEMETRY_DECIMATION * 1000000ul / ADC_UPDATE_FREQ);
+    uint16_t pwmPeriod = TMR2_RESET << 2;
+    
+    gHeader[0] = gEvent;
+    gHeader[1] = count;
+    gHeader[2] = trigger;
+    gHeader[3] = 0;
+    gHeader[4] = (uint8_t)periodUs;
+    gHeader[5] = (uint8_t)(periodUs >> 8);
+    gHeader[6] = (uint8_t)pwmPeriod;
+    gHeader[7] = (uint8_t)(pwmPeriod >> 8);
+    
+    gSendPos = 0;
+    gSendSize = RECORD_SIZE(count);
+    gState = STATE_SENDING;
+    
+    return 1;
+}
+
+static uint8_t RecordByte(uint8_t pos)
+{
+    if (pos < TELEMETRY_HEADER_SIZE) return gHeader[pos];
+    
+    // The oldest sample goes first.
+    pos -= TELEMETRY_HEADER_SIZE;
+    uint8_t index = pos / TELEMETRY_SAMPLE_SIZE;
+    return gSamples[(uint8_t)(gHead - gFilled + index) & TELEMETRY_MASK][pos % TELEMETRY_SAMPLE_SIZE];
+}
+
+void Telemetry_Task(void)
+{
+    if (STATE_FROZEN == gState)
+    {
+        // The receiver configuration owns the EUSART while it runs.
+        uint8_t config = GpsConfig_GetState();
+        if (GPS_CONFIG_STATE_PENDING == config || GPS_CONFIG_STATE_VERIFYING == config) return;
+        
+        // Another frame may be open.
+        if (!StartRecord()) return;
+    }
+    
+    if (STATE_SENDING != gState) return;
+    
+    // Top up the transmit ring, without waiting for it.
+    while (gSendPos < gSendSize)
+    {
+        if (!Diag_Put(RecordByte(gSendPos))) return;
+        ++gSendPos;
+    }
+    
+    if (!Diag_EndFrame()) return;
+    
+    // Re-arm. The ISR doesn't touch the ring until the state changes.
+    gFilled = 0;
+    gDecimation = 0;
+    gEvents = 0;
+    gEvent = TELEMETRY_EVENT_NONE;
+    gState = STATE_ARMED;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef TELEMETRY_H
+#define	TELEMETRY_H
+
+#include <xc.h>
+
+/*
+ * Records the boost converter loop into a ring in RAM and sends it as a DIAG_RECORD_TELEMETRY frame (see diag.h), for
+ * Host/diag_tool.c to turn into CSV.
+ *
+ * Capture runs until a trigger event, continues for TELEMETRY_POST_TRIGGER more samples, then freezes so the ring
+ * holds the lead-up to the event as well as what followed. The frozen ring is sent, and capture re-arms. With no
+ * triggers selected, every full ring is sent.
+ *
+ * Nothing is sent while the GPS receiver is being configured.
+ */
+
+// Defining this macro records the boost converter loop and streams it over the EUSART. It takes ~200 bytes of RAM.
+//#define TELEMETRY_ENABLED
+
+// Trigger events, which are also the sample flags.
+#define TELEMETRY_EVENT_NONE 0x00
+#define TELEMETRY_EVENT_OVP 0x01    // The output went over the OVP limit.
+#define TELEMETRY_EVENT_WINDOW 0x02 // The output left HV_MIN-HV_MAX once HV was ready (see BoostConverter_HvInRange).
+
+///
+/// The events that freeze the capture. Set to TELEMETRY_EVENT_NONE to send every full ring.
+#define TELEMETRY_TRIGGERS (TELEMETRY_EVENT_OVP | TELEMETRY_EVENT_WINDOW)
+
+///
+/// The ring length, in samples. Must be a power of two.
+#define TELEMETRY_SAMPLES 64
+
+///
+/// The number of boost converter updates per sample; 4 gives 2 ms per sample and a 128 ms ring.
+#define TELEMETRY_DECIMATION 4
+
+///
+/// The samples captured after a trigger.
+#define TELEMETRY_POST_TRIGGER (TELEMETRY_SAMPLES / 2)
+
+// Record payload:
+//   event (TELEMETRY_EVENT_XXX), sample count, trigger sample (TELEMETRY_NO_TRIGGER if none), reserved,
+//   sample period in us (uint16), PWM period in duty cycle counts (uint16), samples
+//
+// Each sample is 3 bytes, holding 24 bits:
+//   0-11   The filtered ADC value, with 2 fractional bits
+//   12-21  The PWM duty cycle, in PWM counts
+//   22-23  TELEMETRY_EVENT_XXX flags seen since the last sample
+#define TELEMETRY_HEADER_SIZE 8
+#define TELEMETRY_SAMPLE_SIZE 3
+#define TELEMETRY_NO_TRIGGER 0xFF
+
+#ifdef TELEMETRY_ENABLED
+
+/// Records an update of the boost converter. Called by the ADC interrupt (through BoostConverter_Update).
+///
+/// @param cv The filtered ADC value.
+/// @param dutyCycle The PWM duty cycle, in PWM counts.
+/// @param events The TELEMETRY_EVENT_XXX flags for this update.
+void Telemetry_Record(uint16_t cv, uint16_t dutyCycle, uint8_t events);
+
+///
+/// Sends a frozen capture, as many bytes at a time as the transmit ring has room for. Called every few ms.
+void Telemetry_Task(void);
+
+#endif
+
+#endif	/* TELEMETRY_H */
+
@@ -0,0 +1,313 @@
+#include "time_sync.h"
+#include "rtc.h"
+#include "timer.h"
+
+static uint8_t gWriteCount = 0;
+
+static void SetRtc(const volatile struct DateTime* datetime)
+{
+    RTC_Set(datetime);
+    ++gWriteCount;
+}
+
+uint8_t TimeSync_GetWriteCount(void)
+{
+    return gWriteCount;
+}
+
+#ifdef GPS_PPS_ENABLED
+
+#define SECOND_US 1000000l
+
+// PPS is considered lost if no edge arrives in this long.
+#define PPS_TIMEOUT_US 1500000ul
+
+// How close to the next edge TimeSync_Task starts waiting for it, and how long past it before giving up. It's longer
+// than GPS_PERIOD, so one call lands in the window, and the wait holds up the other tasks for no more than twice this.
+#define WRITE_WINDOW_US 3000ul
+
+// Seconds rollovers seen across a longer gap than this (e.g. a slow UI redraw) are too coarse to sample.
+#define MAX_SAMPLE_GAP_US 100000ul
+
+// The bounds of the phase estimate are widened by this much each sample to follow RTC drift. A DS3231 is good to
+// 2 ppm, so this is generous.
+#define DRIFT_US 10
+
+// The RTC is rewritten when its phase is known to be off by more than this.
+#define PHASE_TOLERANCE_US 1000l
+
+// The RTC is rewritten when this many consecutive GPS messages disagree with it.
+#define MISMATCH_LIMIT 3
+
+static volatile uint32_t gPpsTime = 0;
+static volatile uint8_t gPpsCount = 0;
+
+static uint8_t gLocked = 0;
+static uint8_t gLastCount = 0;
+
+#ifdef RTC_SQW_ENABLED
+static uint32_t gLastTickTime = 0;
+#else
+static uint32_t gLastReadTime = 0;
+static uint8_t gLastSecond = 0xFF;
+#endif
+
+// The RTC rollover is known to lie within [gPhaseLow, gPhaseHigh] s of the PPS edge.
+static int32_t gPhaseLow = 0;
+static int32_t gPhaseHigh = 0;
+static uint8_t gPhaseValid = 0;
+
+static struct DateTime gPendingTime;
+static uint8_t gPendingCount = 0;
+static uint8_t gWritePending = 0;
+static uint8_t gMismatches = 0;
+
+// Takes a consistent snapshot of the last edge, returning its count.
+static uint8_t ReadPps(uint32_t* time)
+{
+    uint8_t count;
+    do
+    {
+        count = gPpsCount;
+        *time = gPpsTime;
+    }
+    while (count != gPpsCount);
+
+    return count;
+}
+
+static void ResetPhase(void)
+{
+    gPhaseValid = 0;
+#ifndef RTC_SQW_ENABLED
+    gLastSecond = 0xFF;
+#endif
+}
+
+// Narrows the phase estimate with an RTC rollover known to have happened between previousRead and read.
+static void SamplePhase(uint32_t previousRead, uint32_t read)
+{
+    uint32_t ppsTime;
+    ReadPps(&ppsTime);
+
+    int32_t high = (int32_t)(read - ppsTime);
+    int32_t low = (int32_t)(previousRead - ppsTime);
+
+    // Rollovers just before the edge are measured from the previous edge.
+    if (high >= SECOND_US / 2)
+    {
+        high -= SECOND_US;
+        low -= SECOND_US;
+    }
+
+    if (gPhaseValid)
+    {
+        gPhaseLow -= DRIFT_US;
+        gPhaseHigh += DRIFT_US;
+    }
+
+    if (!gPhaseValid || low > gPhaseHigh || high < gPhaseLow)
+    {
+        // First sample, or it disagrees with the estimate (e.g. the RTC was set), so start over.
+        gPhaseLow = low;
+        gPhaseHigh = high;
+        gPhaseValid = 1;
+    }
+    else
+    {
+        if (low > gPhaseLow) gPhaseLow = low;
+        if (high < gPhaseHigh) gPhaseHigh = high;
+    }
+}
+
+// True if the estimate is narrow enough to trust, and lies outside the tolerance.
+static uint8_t PhaseOff(void)
+{
+    if (!gPhaseValid || (gPhaseHigh - gPhaseLow) > PHASE_TOLERANCE_US) return 0;
+    
+    return gPhaseLow > PHASE_TOLERANCE_US / 2 || gPhaseHigh < -PHASE_TOLERANCE_US / 2;
+}
+
+static uint8_t DateTimesEqual(volatile const struct DateTime* a, volatile const struct DateTime* b)
+{
+    return !DateTimeAfter(a, b) && !DateTimeBefore(a, b);
+}
+
+void TimeSync_Init(void)
+{
+    // RA1 is a digital input, interrupting on the rising edge (17.3)
+    TRISA |= PPS_PIN_MASK;
+    IOCAP |= PPS_PIN_MASK;
+}
+
+void TimeSync_HandlePpsInterrupt(void)
+{
+    IOCAF &= ~PPS_PIN_MASK;
+
+    gPpsTime = Timer_GetMicros();
+    ++gPpsCount;
+}
+
+void TimeSync_ReadRtc(void)
+{
+    // The DS3231 latches the time registers at the start of the read.
+    uint32_t now = Timer_GetMicros();
+    RTC_Read();
+
+#ifdef RTC_SQW_ENABLED
+    // The square wave edge marks the rollover exactly.
+    uint32_t tickTime = RTC_GetTickTime();
+
+    if (gLocked && tickTime != gLastTickTime && (now - tickTime) < MAX_SAMPLE_GAP_US)
+    {
+        SamplePhase(tickTime, tickTime);
+    }
+
+    gLastTickTime = tickTime;
+#else
+    uint8_t second = gRtcDateTime.second;
+
+    if (gLocked && 0xFF != gLastSecond && second != gLastSecond && (now - gLastReadTime) < MAX_SAMPLE_GAP_US)
+    {
+        SamplePhase(gLastReadTime, now);
+    }
+
+    gLastSecond = second;
+    gLastReadTime = now;
+#endif
+}
+
+void TimeSync_OnGpsTime(volatile const struct DateTime* gpsTime)
+{
+    if (!gLocked)
+    {
+        if (!TimesAreClose(gpsTime, &gRtcDateTime)) SetRtc(gpsTime);
+        return;
+    }
+
+    // The message describes the last edge, so a synchronized RTC shows the same second. The RTC may have been read
+    // just before the edge, so only act on persistent disagreement.
+    if (DateTimesEqual(gpsTime, &gRtcDateTime)) gMismatches = 0;
+    else if (gMismatches < MISMATCH_LIMIT) ++gMismatches;
+
+    if (gWritePending || (gMismatches < MISMATCH_LIMIT && !PhaseOff())) return;
+
+    // Schedule the write of the next second for the next edge.
+    uint32_t ppsTime;
+    gPendingCount = ReadPps(&ppsTime);
+    gPendingTime = *gpsTime;
+    AddSecond(&gPendingTime);
+    gWritePending = 1;
+}
+
+void TimeSync_Task(void)
+{
+    uint32_t ppsTime;
+    uint8_t count = ReadPps(&ppsTime);
+    uint32_t elapsed = Timer_MicrosSince(ppsTime);
+
+    if (count != gLastCount)
+    {
+        gLastCount = count;
+        gLocked = 1;
+    }
+    else if (gLocked && elapsed > PPS_TIMEOUT_US)
+    {
+        gLocked = 0;
+        gWritePending = 0;
+        ResetPhase();
+    }
+
+    if (!gWritePending) return;
+
+    // An edge went by since the write was scheduled, so the pending time is stale. The next message will retry.
+    if (count != gPendingCount)
+    {
+        gWritePending = 0;
+        return;
+    }
+
+    // Not there yet, so check again on the next call rather than hold up the other tasks.
+    if (elapsed < SECOND_US - WRITE_WINDOW_US) return;
+
+    while (gPpsCount == count)
+    {
+        if (Timer_MicrosSince(ppsTime) > SECOND_US + WRITE_WINDOW_US)
+        {
+            gWritePending = 0;
+            return;
+        }
+    }
+
+    // Writing the seconds register resets the DS3231 countdown chain, so the RTC second now starts on the edge.
+    SetRtc(&gPendingTime);
+
+    gWritePending = 0;
+    gMismatches = 0;
+    gLastCount = gPpsCount;
+    ResetPhase();
+}
+
+uint8_t TimeSync_PpsLocked(void)
+{
+    return gLocked;
+}
+
+int16_t TimeSync_GetPhaseError(void)
+{
+    if (!gPhaseValid) return TIME_SYNC_PHASE_UNKNOWN;
+
+    return (int16_t)((gPhaseLow + gPhaseHigh) / 200);
+}
+
+uint8_t TimeSync_GetPhaseMicros(int32_t* phase, uint16_t* uncertainty)
+{
+    if (!gPhaseValid) return 0;
+    
+    *phase = (gPhaseLow + gPhaseHigh) / 2;
+    *uncertainty = (uint16_t)(gPhaseHigh - gPhaseLow);
+    
+    return 1;
+}
+
+#else
+
+void TimeSync_Init(void)
+{
+}
+
+void TimeSync_HandlePpsInterrupt(void)
+{
+}
+
+void TimeSync_ReadRtc(void)
+{
+    RTC_Read();
+}
+
+void TimeSync_OnGpsTime(volatile const struct DateTime* gpsTime)
+{
+    if (!TimesAreClose(gpsTime, &gRtcDateTime)) SetRtc(gpsTime);
+}
+
+void TimeSync_Task(void)
+{
+}
+
+uint8_t TimeSync_PpsLocked(void)
+{
+    return 0;
+}
+
+int16_t TimeSync_GetPhaseError(void)
+{
+    return TIME_SYNC_PHASE_UNKNOWN;
+}
+
+uint8_t TimeSync_GetPhaseMicros(int32_t* phase, uint16_t* uncertainty)
+{
+    return 0;
+}
+
+#endif
+
@@ -0,0 +1,61 @@
+#ifndef TIME_SYNC_H
+#define	TIME_SYNC_H
+
+#include <xc.h>
+#include "time_utils.h"
+
+// Defining this macro enables the GPS timepulse (PPS) input on RA1. The NEO-6M TIMEPULSE output must be wired to the
+// ICSPCLK pin. Without it the RTC is only corrected when it is a full second off, as soon as the time message parses.
+//#define GPS_PPS_ENABLED
+
+// The PPS pin, RA1
+#define PPS_PIN_MASK 0x02
+
+///
+/// Returned by TimeSync_GetPhaseError when the phase isn't known (no PPS, or not enough RTC samples yet).
+#define TIME_SYNC_PHASE_UNKNOWN INT16_MIN
+
+///
+/// Configures the PPS input.
+void TimeSync_Init(void);
+
+///
+/// Called by the ISR when the PPS pin has a rising edge.
+void TimeSync_HandlePpsInterrupt(void);
+
+///
+/// Reads the RTC into gRtc and updates the phase estimate from the seconds register.
+void TimeSync_ReadRtc(void);
+
+/// Checks the RTC against a valid GPS time and corrects it if needed. With PPS the write is deferred to the next edge
+/// by TimeSync_Task.
+///
+/// @param gpsTime The (local) time of the most recent PPS edge.
+void TimeSync_OnGpsTime(volatile const struct DateTime* gpsTime);
+
+///
+/// Performs a pending PPS-aligned RTC write. Called every GPS_PERIOD from GpsTask.
+/// @note Once the edge is due within a few ms, this blocks for up to ~6 ms while waiting for it.
+void TimeSync_Task(void);
+
+///
+/// True if PPS edges are arriving.
+uint8_t TimeSync_PpsLocked(void);
+
+///
+/// The offset of the RTC second from the PPS edge in 0.1 ms units. Positive values mean the RTC lags GPS.
+int16_t TimeSync_GetPhaseError(void);
+
+/// The phase estimate in s, as for TimeSync_GetPhaseError.
+///
+/// @param phase Receives the offset of the RTC second from the PPS edge.
+/// @param uncertainty Receives the width of the interval the true phase is known to lie in.
+/// @return 0 if the phase isn't known.
+uint8_t TimeSync_GetPhaseMicros(int32_t* phase, uint16_t* uncertainty);
+
+///
+/// Free-running count of RTC writes made to correct the time.
+uint8_t TimeSync_GetWriteCount(void);
+
+#endif	/* TIME_SYNC_H */
+
@@ -138,3 +138,33 @@ uint8_t TimesAreClose(volatile const struct DateTime* a, volatile const struct D
         return AbsModDiff(a->second, b->second, 60) <= 1;
     }
 }
+
+uint8_t GetDaysInMonth(uint8_t year, uint8_t month)
+{
+    static const uint8_t DAYS_IN_MONTH[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    
+    // February - I'm not bothering with anything more than standard leap days
+    if ((2 == month) && !(year % 4)) return 29;
+    
+    return DAYS_IN_MONTH[month - 1];
+}
+
+void AddSecond(volatile struct DateTime* datetime)
+{
+    if (++datetime->second < 60) return;
+    datetime->second = 0;
+    
+    if (++datetime->minute < 60) return;
+    datetime->minute = 0;
+    
+    if (++datetime->hour < 24) return;
+    datetime->hour = 0;
+    
+    if (++datetime->day <= GetDaysInMonth(datetime->year, datetime->month)) return;
+    datetime->day = 1;
+    
+    if (++datetime->month <= 12) return;
+    datetime->month = 1;
+    
+    ++datetime->year;
+}
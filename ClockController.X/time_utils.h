@@ -53,5 +53,11 @@ uint8_t DateTimeBefore(volatile const struct DateTime* a, volatile const struct
 // True if a and b are within a second of each other
 uint8_t TimesAreClose(volatile const struct DateTime* a, volatile const struct DateTime* b);
 
+// The number of days in the month, for years [2000..2099].
+uint8_t GetDaysInMonth(uint8_t year, uint8_t month);
+
+// Advances the date/time by one second, rolling over minutes, hours, days, months and years as needed.
+void AddSecond(volatile struct DateTime* datetime);
+
 #endif	/* TIME_UTILS_H */
 
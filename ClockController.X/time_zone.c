@@ -1,10 +1,9 @@
 #include "time_zone.h"
+#include "nvm.h"
 
 int8_t gTimeZoneOffset = -6;
 uint8_t gDstType = DST_TYPE_AUTO_US;
 
-#define TIME_ZONE_MEMORY_LOCATION 0x8000
-
 const char* TIME_ZONE_ABRV[27][2] =
 { //   _TZ_    _ST_    _DT_
     { "BIT",  "BIT"  }, // -12
@@ -42,55 +41,19 @@ const char* DST_TYPE_ABRV[2] =
     "Auto (US)",
 };
 
-void UnlockNVM(void)
-{
-    // Disable interrupts during unlock
-    INTCONbits.GIE = 0;
-    
-    // Unlock sequence (15.3.2)
-    NVMCON2 = 0x55;
-    NVMCON2 = 0xAA;
-    NVMCON1bits.WR = 1; 
-    
-    INTCONbits.GIE = 1;
-}
-
 void TimeZone_Save(void)
 {
-    // Clear the memory (15.3.3)
-    NVMREGS = 1;
-    NVMCON1bits.FREE = 1;
-    NVMCON1bits.WREN = 1;
-    NVMADR = TIME_ZONE_MEMORY_LOCATION;
-    UnlockNVM();
-    
-    //
-    // NOTE: We're only writing a single word, so there is no need to load the write latches.
-    //
-
-    // Write (15.3.4)
-    NVMREGS = 1;
-    NVMCON1bits.FREE = 0;
-    NVMCON1bits.WREN = 1;
-    NVMADR = TIME_ZONE_MEMORY_LOCATION;
-    NVMDATL = (uint8_t)gTimeZoneOffset;
-    NVMDATH = gDstType;
-    UnlockNVM();
-
-    NVMCON1bits.WREN = 0;
+    Nvm_Write(NVM_WORD_TIME_ZONE, ((uint16_t)gDstType << 8) | (uint8_t)gTimeZoneOffset);
 }
 
 void TimeZone_Load(void)
 {
-    // Read the memory (15.3.1)
-    NVMREGS = 1;
-    NVMADR = TIME_ZONE_MEMORY_LOCATION;
-    NVMCON1bits.RD = 1;
+    uint16_t data = Nvm_Read(NVM_WORD_TIME_ZONE);
     
-    // 0x3FFF is the cleared state of the memory, which means nothing has been save yet.
-    if (NVMDAT != 0x3FFF)
+    // NVM_EMPTY is the cleared state of the memory, which means nothing has been save yet.
+    if (data != NVM_EMPTY)
     {
-        gTimeZoneOffset = (int8_t)NVMDATL;
-        gDstType = NVMDATH;
+        gTimeZoneOffset = (int8_t)(data & 0xFF);
+        gDstType = (uint8_t)(data >> 8);
     }
-}
\ No newline at end of file
+}
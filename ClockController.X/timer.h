@@ -4,13 +4,57 @@
 #include <xc.h>
 #include "clock.h"
 
-#define TMR2_POST 2 // [1-16]
+// The post-scaler divides both the TMR2 interrupt and the ADC trigger (see adc.h).
+#define TMR2_POST 8 // [1-16]
 #define TMR2_FREQ (64 * 1000ul)
 #define TMR2_RESET ((_XTAL_FREQ / 4) / TMR2_FREQ)
+#define TMR2_INTERRUPT_FREQ (TMR2_FREQ / TMR2_POST)
 
 void InitTimer(void);
 
+///
+/// Called by the ISR to process TMR2 interrupts. Advances the millisecond tick.
 void TimerInterruptHandler(void);
 
+/// Gets the millisecond tick.
+///
+/// @returns Milliseconds since InitTimer. This wraps every ~65 seconds, so only differences are meaningful.
+/// @note Safe to call from the interrupt context.
+uint16_t Timer_GetMillis(void);
+
+///
+/// Milliseconds from start to now, correct across a wrap of the tick.
+#define TIMER_ELAPSED(start, now) ((uint16_t)((now) - (start)))
+
+///
+/// True if deadline is at or before now. Deadlines must be less than ~32 seconds away from now.
+#define TIMER_DUE(deadline, now) ((int16_t)((now) - (deadline)) >= 0)
+
+/// Gets the milliseconds since a tick value.
+///
+/// @param start A value returned by Timer_GetMillis.
+uint16_t Timer_MillisSince(uint16_t start);
+
+/// Checks a deadline against the current tick.
+///
+/// @param deadline A Timer_GetMillis value plus a delay of less than ~32 seconds.
+/// @returns 1 if the deadline has passed.
+uint8_t Timer_Expired(uint16_t deadline);
+
+///
+/// Called by the ISR to process TMR1 overflow interrupts.
+void Timer1InterruptHandler(void);
+
+/// Gets a free-running timestamp from TMR1.
+///
+/// @returns The timestamp in microseconds. This wraps every ~71 minutes, so only differences are meaningful.
+/// @note Safe to call from the interrupt context.
+uint32_t Timer_GetMicros(void);
+
+/// Gets the microseconds since a timestamp.
+///
+/// @param start A value returned by Timer_GetMicros.
+uint32_t Timer_MicrosSince(uint32_t start);
+
 #endif	/* TIMER_H */
 
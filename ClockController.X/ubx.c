@@ -0,0 +1,22 @@
+#include "ubx.h"
+#include "serial.h"
+
+void UBX_UpdateChecksum(struct UbxChecksum* checksum, uint8_t data)
+{
+    checksum->a += data;
+    checksum->b += checksum->a;
+}
+
+void UBX_Send(uint8_t msgClass, uint8_t msgId, const void* payload, uint8_t len)
+{
+    // The checksum covers everything between the sync characters and the checksum itself (31.4)
+    uint8_t header[6] = { UBX_SYNC_1, UBX_SYNC_2, msgClass, msgId, len, 0 };
+    struct UbxChecksum checksum = { 0, 0 };
+    
+    for (uint8_t i = 2; i < sizeof(header); ++i) UBX_UpdateChecksum(&checksum, header[i]);
+    for (uint8_t i = 0; i < len; ++i) UBX_UpdateChecksum(&checksum, ((const uint8_t*)payload)[i]);
+    
+    Serial_Write(header, sizeof(header));
+    Serial_Write(payload, len);
+    Serial_Write(&checksum, sizeof(checksum));
+}
@@ -0,0 +1,57 @@
+#ifndef UBX_H
+#define	UBX_H
+
+/*
+ * Code is based on the document "u-blox 6 Receiver Description". Section notes in this file reference that document.
+ */
+
+#include <xc.h>
+
+// Frame sync characters (31.2)
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+
+// Message classes (31.6)
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_NMEA 0xF0
+
+// Message IDs
+#define UBX_NAV_TIMEUTC 0x21 // UTC time solution
+#define UBX_CFG_PRT 0x00 // Port configuration
+#define UBX_CFG_MSG 0x01 // Message rate
+
+// Standard NMEA message IDs, for use with UBX_CLASS_NMEA
+#define UBX_NMEA_GGA 0x00
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSA 0x02
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_RMC 0x04
+#define UBX_NMEA_VTG 0x05
+
+///
+/// The running state of the 8-bit Fletcher checksum used by UBX frames (31.4).
+struct UbxChecksum
+{
+    uint8_t a;
+    uint8_t b;
+};
+
+/// Adds a byte to a checksum.
+///
+/// @param checksum The checksum to update. Both bytes start at 0.
+/// @param data The byte to add.
+void UBX_UpdateChecksum(struct UbxChecksum* checksum, uint8_t data);
+
+/// Frames and transmits a UBX message.
+///
+/// @param msgClass The message class.
+/// @param msgId The message ID.
+/// @param payload A pointer to the payload.
+/// @param len The length of the payload, in bytes.
+/// @NOTE This call blocks until the message has been handed to the EUSART.
+void UBX_Send(uint8_t msgClass, uint8_t msgId, const void* payload, uint8_t len);
+
+#endif	/* UBX_H */
+
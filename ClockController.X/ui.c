@@ -10,6 +10,11 @@
 #include "timer.h"
 #include "ap33772.h"
 #include "nixie.h"
+#include "time_sync.h"
+#include "rtc_calibration.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "boot.h"
 
 #include <xc.h>
 
@@ -32,14 +37,30 @@ static uint8_t gState = STATE_PAGE_SCROLL;
 
 static uint8_t gField = FIELD_TIME_ZONE;
 
+// HV calibration, on the boost page: the output is held at each point while the voltage measured at it is dialed in.
+// The dial follows the displayed voltage until it's turned, so pressing through both points without turning it
+// leaves the calibration as it was.
+static uint8_t gCalPoint = HV_CAL_POINT_NONE;
+static uint16_t gCalDeciVolts;
+static uint8_t gCalDialed = 0;
+static uint8_t gCalEdited = 0;
+static uint8_t gCalFailed = 0;
+
 #define PAGE_NONE  0
 #define PAGE_STATUS 1
 #define PAGE_TIME_ZONE 2
 #define PAGE_BOOST 3
 #define PAGE_USB_PD 4
 #define PAGE_NIXIE_STATUS 5
+#define PAGE_RTC_DRIFT 6
+#define PAGE_BOOT 7
 
-#define PAGE_COUNT 5
+#ifdef PROFILER_ENABLED
+#define PAGE_PROFILER 8
+#define PAGE_COUNT 8
+#else
+#define PAGE_COUNT 7
+#endif
 
 static uint8_t gCurrentPage = PAGE_NONE;
 
@@ -55,7 +76,7 @@ void DrawPageTemplate(void)
         case PAGE_STATUS:
             OLED_DrawString(0, 0, xstr(PAGE_STATUS) "/" xstr(PAGE_COUNT) " STATUS           ", 1);
             OLED_DrawString(1, 0, "20##-##-## ##:##:##", 0);
-            OLED_DrawString(2, 0, "GPS:", 0);
+            OLED_DrawString(2, 0, "GPS:     PPS", 0);
             OLED_DrawString(3, 0, "###V @ ##%", 0);
             break;
             
@@ -78,13 +99,38 @@ void DrawPageTemplate(void)
             OLED_DrawString(0, 0, xstr(PAGE_USB_PD) "/" xstr(PAGE_COUNT) " USB PD           ", 1);
             OLED_DrawString(1, 0, "PDO #: ## A @ ## V", 0);
             OLED_DrawString(2, 0, "#### mA @ ##### mV", 0);
+            OLED_DrawString(3, 0, "Evt ### --:--:-- ---", 0);
             break;
             
         case PAGE_NIXIE_STATUS:
             OLED_DrawString(0, 0, xstr(PAGE_NIXIE_STATUS) "/" xstr(PAGE_COUNT) " Nixie Tubes      ", 1);
             OLED_DrawString(1, 0, "?? : ?? : ??", 0);
             OLED_DrawString(2, 0, "?? : ?? : ??", 0);
+            OLED_DrawString(3, 0, "HV out: ### / ####ms", 0);
             break;            
+            
+        case PAGE_RTC_DRIFT:
+            OLED_DrawString(0, 0, xstr(PAGE_RTC_DRIFT) "/" xstr(PAGE_COUNT) " RTC Drift        ", 1);
+            OLED_DrawString(1, 0, "Drift: +##.## ppm", 0);
+            OLED_DrawString(2, 0, "Aging: +###  Adj: ###", 0);
+            OLED_DrawString(3, 0, "RTC writes: ###", 0);
+            break;
+            
+        case PAGE_BOOT:
+            OLED_DrawString(0, 0, xstr(PAGE_BOOT) "/" xstr(PAGE_COUNT) " Boot Timeline    ", 1);
+            OLED_DrawString(1, 0, "OL ---.-- PD ---.--", 0);
+            OLED_DrawString(2, 0, "HV ---.-- NX ---.--", 0);
+            OLED_DrawString(3, 0, "GC ---.-- GT ---.--", 0);
+            break;
+            
+#ifdef PROFILER_ENABLED
+        case PAGE_PROFILER:
+            OLED_DrawString(0, 0, xstr(PAGE_PROFILER) "/" xstr(PAGE_COUNT) " CPU Load %       ", 1);
+            OLED_DrawString(1, 0, "I2C## RX## TX## T2##", 0);
+            OLED_DrawString(2, 0, "ADC## IOC## Idle##", 0);
+            OLED_DrawString(3, 0, "    n=##### mx=#####", 0);
+            break;
+#endif
     }
 }
 
@@ -134,6 +180,13 @@ void UI_HandleRotationCW(void)
             break;
             
         case STATE_VALUE_SCROLL:
+            if (PAGE_BOOST == gCurrentPage)
+            {
+                if (gCalDeciVolts < HV_CAL_MAX_DECIVOLTS) ++gCalDeciVolts;
+                gCalDialed = 1;
+                break;
+            }
+            
             // Time zone range is [-12, +14]]
             if (0 == gField) 
             {
@@ -168,6 +221,13 @@ void UI_HandleRotationCCW(void)
             break;
             
         case STATE_VALUE_SCROLL:
+            if (PAGE_BOOST == gCurrentPage)
+            {
+                if (gCalDeciVolts > 0) --gCalDeciVolts;
+                gCalDialed = 1;
+                break;
+            }
+            
             // Time zone range is [-12, +14]]
             if (0 == gField)
             {
@@ -183,6 +243,37 @@ void UI_HandleRotationCCW(void)
     }
 }
 
+// Steps through the calibration: hold the low point, capture it, hold the high point, capture it and save.
+void HandleCalibrationPress(void)
+{
+    if (STATE_PAGE_SCROLL == gState)
+    {
+        gCalPoint = HV_CAL_POINT_LO;
+        gCalEdited = 0;
+        gCalFailed = 0;
+        gState = STATE_VALUE_SCROLL;
+    }
+    else if (HV_CAL_POINT_LO == gCalPoint)
+    {
+        BoostConverter_CaptureCalibrationPoint(gCalPoint, gCalDeciVolts);
+        gCalEdited = gCalDialed;
+        
+        gCalPoint = HV_CAL_POINT_HI;
+    }
+    else
+    {
+        BoostConverter_CaptureCalibrationPoint(gCalPoint, gCalDeciVolts);
+        if (gCalEdited || gCalDialed) gCalFailed = !BoostConverter_SaveCalibration();
+        
+        gCalPoint = HV_CAL_POINT_NONE;
+        gState = STATE_PAGE_SCROLL;
+        DrawPageTemplate();
+    }
+    
+    gCalDialed = 0;
+    BoostConverter_HoldCalibrationPoint(gCalPoint);
+}
+
 void UI_HandleButtonPress(void)
 {
     gButtonState.c.edge = 0;
@@ -204,6 +295,10 @@ void UI_HandleButtonPress(void)
                 break;
         }
     }
+    else if (gCurrentPage == PAGE_BOOST)
+    {
+        HandleCalibrationPress();
+    }
     else
     {
         gDisplayTimer = 0;
@@ -218,18 +313,15 @@ void DrawStatusPage(void)
 {
     static uint8_t ovpHold = 0;
     
-    struct DateTime rtcTime;
-    ConvertRtcToDateTime(&gRtc, &rtcTime);
-    
     // Date
-    OLED_DrawNumber8(1, 2, rtcTime.year, 2);
-    OLED_DrawNumber8(1, 5, rtcTime.month, 2);
-    OLED_DrawNumber8(1, 8, rtcTime.day, 2);
+    OLED_DrawNumber8(1, 2, gRtcDateTime.year, 2);
+    OLED_DrawNumber8(1, 5, gRtcDateTime.month, 2);
+    OLED_DrawNumber8(1, 8, gRtcDateTime.day, 2);
     
     // Time
-    OLED_DrawNumber8(1, 11, rtcTime.hour, 2);
-    OLED_DrawNumber8(1, 14, rtcTime.minute, 2);
-    OLED_DrawNumber8(1, 17, rtcTime.second, 2);
+    OLED_DrawNumber8(1, 11, gRtcDateTime.hour, 2);
+    OLED_DrawNumber8(1, 14, gRtcDateTime.minute, 2);
+    OLED_DrawNumber8(1, 17, gRtcDateTime.second, 2);
     
     // GPS
     OLED_DrawString(
@@ -237,6 +329,23 @@ void DrawStatusPage(void)
         5, 
         'A' == gGpsData.status ? "OK " : (0 == gGpsData.status ? "?  " : "Acq"),
         0);
+    
+    // PPS phase error "+###.#ms"
+    int16_t phase = TimeSync_GetPhaseError();
+    if (TIME_SYNC_PHASE_UNKNOWN == phase)
+    {
+        OLED_DrawString(2, 13, TimeSync_PpsLocked() ? "  ...   " : "  ---   ", 0);
+    }
+    else
+    {
+        uint16_t magnitude = (uint16_t)(phase < 0 ? -phase : phase);
+        
+        OLED_DrawCharacter(2, 13, phase < 0 ? '-' : '+', 0);
+        OLED_DrawNumber16(2, 14, magnitude / 10, 3);
+        OLED_DrawCharacter(2, 17, '.', 0);
+        OLED_DrawNumber8(2, 18, magnitude % 10, 1);
+        OLED_DrawString(2, 19, "ms", 0);
+    }
 
     // "###V @ ##%"
     OLED_DrawNumber8(3, 0, BoostConverter_GetVoltage(), 3);
@@ -251,18 +360,15 @@ void DrawStatusPage(void)
 
 void DrawTimeZonePage(void)
 {
-    struct DateTime rtcTime;
-    ConvertRtcToDateTime(&gRtc, &rtcTime);
-
     // Date
-    OLED_DrawNumber8(1, 2, rtcTime.year, 2);
-    OLED_DrawNumber8(1, 5, rtcTime.month, 2);
-    OLED_DrawNumber8(1, 8, rtcTime.day, 2);
+    OLED_DrawNumber8(1, 2, gRtcDateTime.year, 2);
+    OLED_DrawNumber8(1, 5, gRtcDateTime.month, 2);
+    OLED_DrawNumber8(1, 8, gRtcDateTime.day, 2);
     
     // Time
-    OLED_DrawNumber8(1, 11, rtcTime.hour, 2);
-    OLED_DrawNumber8(1, 14, rtcTime.minute, 2);
-    OLED_DrawNumber8(1, 17, rtcTime.second, 2);
+    OLED_DrawNumber8(1, 11, gRtcDateTime.hour, 2);
+    OLED_DrawNumber8(1, 14, gRtcDateTime.minute, 2);
+    OLED_DrawNumber8(1, 17, gRtcDateTime.second, 2);
     
     // Time Zone
     OLED_DrawCharacter(2, 7, gTimeZoneOffset < 0 ? '-' : '+', 0);
@@ -303,7 +409,29 @@ void DrawBoostPage(void)
     OLED_DrawNumber8(1, 8, BoostConverter_GetVoltage(), 3);
     OLED_DrawNumber16(2, 5, BoostConverter_GetDutyCycle(), 4);
     OLED_DrawNumber16(2, 16, BoostConverter_GetDutyCyclePct(), 2);
-    OLED_DrawNumber16(3, 5, gAdcCv * 4, 4);
+    
+    if (HV_CAL_POINT_NONE == gCalPoint)
+    {
+        // The pin voltage in mV is 4x the ADC value.
+        OLED_DrawNumber16(3, 5, Adc_GetDisplayValue() >> (ADC_FRACTION_BITS - 2), 4);
+        if (gCalFailed) OLED_DrawString(3, 14, "CAL ERR", 1);
+        
+        return;
+    }
+    
+    // "Cal #: ###.# V", with the measured voltage being dialed in.
+    if (!gCalDialed)
+    {
+        gCalDeciVolts = BoostConverter_GetDeciVolts();
+        if (gCalDeciVolts > HV_CAL_MAX_DECIVOLTS) gCalDeciVolts = HV_CAL_MAX_DECIVOLTS;
+    }
+    
+    OLED_DrawString(3, 0, "Cal #: ", 0);
+    OLED_DrawNumber8(3, 4, gCalPoint + 1, 1);
+    OLED_DrawNumber16(3, 7, gCalDeciVolts / 10, 3);
+    OLED_DrawCharacter(3, 10, '.', 0);
+    OLED_DrawNumber8(3, 11, gCalDeciVolts % 10, 1);
+    OLED_DrawString(3, 12, " V \x1E\x1F", 0);
 }
 
 void DrawUsbPdPage(void)
@@ -317,6 +445,25 @@ void DrawUsbPdPage(void)
     
     OLED_DrawNumber16(2, 0, status.current, 4);
     OLED_DrawNumber16(2, 10, status.voltage, 5);
+    
+    // The protection events, and the time and kind of the last one. Inverted while the tubes are blanked for it.
+    struct AP33772_Event event;
+    uint8_t count = AP33772_GetLastEvent(&event);
+    OLED_DrawNumber8(3, 4, count, 3);
+    
+    if (count)
+    {
+        OLED_DrawNumber8(3, 8, event.time.hour, 2);
+        OLED_DrawNumber8(3, 11, event.time.minute, 2);
+        OLED_DrawNumber8(3, 14, event.time.second, 2);
+        
+        const char* kind = "DR ";
+        if (event.status & AP33772_STATUS_OVP) kind = "OVP";
+        else if (event.status & AP33772_STATUS_OCP) kind = "OCP";
+        else if (event.status & AP33772_STATUS_OTP) kind = "OTP";
+        
+        OLED_DrawString(3, 17, kind, AP33772_Faulted());
+    }
 }
 
 void DrawNixieStatusPage(void)
@@ -334,7 +481,103 @@ void DrawNixieStatusPage(void)
     OLED_DrawCharacter(2,  6, ((gNixieStatus >> 0xA) & 1) ? '\x03' : '!', 0);
     OLED_DrawCharacter(2, 10, ((gNixieStatus >> 0xD) & 1) ? '\x03' : '!', 0);
     OLED_DrawCharacter(2, 11, ((gNixieStatus >> 0xE) & 1) ? '\x03' : '!', 0);
+    
+    // Times the tubes were blanked for HV excursions, and the longest
+    uint16_t count, lastMs, longestMs;
+    BoostConverter_GetExcursions(&count, &lastMs, &longestMs);
+    
+    OLED_DrawNumber16(3, 8, count > 999 ? 999 : count, 3);
+    OLED_DrawNumber16(3, 14, longestMs > 9999 ? 9999 : longestMs, 4);
+}
+
+void DrawRtcDriftPage(void)
+{
+    int16_t drift = RtcCalibration_GetDrift();
+    if (RTC_DRIFT_UNKNOWN == drift)
+    {
+        OLED_DrawString(1, 7, "   ---", 0);
+    }
+    else
+    {
+        uint16_t magnitude = (uint16_t)(drift < 0 ? -drift : drift);
+        
+        OLED_DrawCharacter(1, 7, drift < 0 ? '-' : '+', 0);
+        OLED_DrawNumber16(1, 8, magnitude / 100, 2);
+        OLED_DrawCharacter(1, 10, '.', 0);
+        OLED_DrawNumber16(1, 11, magnitude % 100, 2);
+    }
+    
+    int8_t aging = RtcCalibration_GetAgingOffset();
+    OLED_DrawCharacter(2, 7, aging < 0 ? '-' : '+', 0);
+    OLED_DrawNumber8(2, 8, (uint8_t)(aging < 0 ? -aging : aging), 3);
+    OLED_DrawNumber8(2, 18, RtcCalibration_GetAdjustmentCount(), 3);
+    
+    OLED_DrawNumber8(3, 12, TimeSync_GetWriteCount(), 3);
+}
+
+// Draws a milestone time as "###.##" seconds, or leaves the dashes.
+static void DrawMilestone(uint8_t row, uint8_t col, uint8_t milestone)
+{
+    uint16_t time = Boot_GetMilestone(milestone);
+    if (BOOT_NOT_REACHED == time) return;
+    
+    OLED_DrawNumber16(row, col, time / 100, 3);
+    OLED_DrawNumber8(row, col + 4, (uint8_t)(time % 100), 2);
+}
+
+void DrawBootPage(void)
+{
+    // Display, PD contract, HV ready, time on the tubes, GPS configured, GPS time
+    DrawMilestone(1, 3, BOOT_MILESTONE_DISPLAY);
+    DrawMilestone(1, 13, BOOT_MILESTONE_PD);
+    DrawMilestone(2, 3, BOOT_MILESTONE_HV);
+    DrawMilestone(2, 13, BOOT_MILESTONE_TUBES);
+    DrawMilestone(3, 3, BOOT_MILESTONE_GPS_CONFIG);
+    DrawMilestone(3, 13, BOOT_MILESTONE_GPS_TIME);
+    
+#ifndef SKIP_PD
+    if (BOOT_STATE_FAILED == Boot_GetState()) OLED_DrawString(1, 13, " fail ", 1);
+    else if (AP33772_LowPower()) OLED_DrawCharacter(1, 19, '!', 1);
+#endif
+}
+
+#ifdef PROFILER_ENABLED
+// Percentage of the instruction cycles in a second.
+uint8_t CyclesToPct(uint32_t cycles)
+{
+    uint32_t pct = cycles / (_XTAL_FREQ / 4 / 100);
+    return pct > 99 ? 99 : (uint8_t)pct;
+}
+
+void DrawProfilerPage(void)
+{
+    static const char* SOURCE_NAMES[PROFILE_SOURCE_COUNT] = { "I2C", "RX ", "T2 ", "ADC", "IOC", "TX " };
+    
+    // Row and column of each source's percentage
+    static const uint8_t SOURCE_ROWS[PROFILE_SOURCE_COUNT] = { 1, 1, 1, 2, 2, 1 };
+    static const uint8_t SOURCE_COLUMNS[PROFILE_SOURCE_COUNT] = { 3, 8, 18, 3, 9, 13 };
+    
+    // The detail line cycles through the sources every 2 seconds.
+    static uint8_t detailCounter = 0;
+    uint8_t detail = (uint8_t)((detailCounter++ / 40) % PROFILE_SOURCE_COUNT);
+    
+    struct ProfileStats stats;
+    for (uint8_t i = 0; i < PROFILE_SOURCE_COUNT; ++i)
+    {
+        Profiler_GetStats(i, &stats);
+        OLED_DrawNumber8(SOURCE_ROWS[i], SOURCE_COLUMNS[i], CyclesToPct(stats.cycles), 2);
+        
+        if (i == detail)
+        {
+            OLED_DrawString(3, 0, SOURCE_NAMES[i], 0);
+            OLED_DrawNumber16(3, 6, stats.count, 5);
+            OLED_DrawNumber16(3, 15, stats.maxCycles, 5);
+        }
+    }
+    
+    OLED_DrawNumber8(2, 16, Scheduler_GetIdlePct(), 2);
 }
+#endif
 
 typedef void PageDrawingFunction(void);
 
@@ -347,6 +590,11 @@ void UI_Update(void)
         &DrawBoostPage,
         &DrawUsbPdPage,
         &DrawNixieStatusPage,
+        &DrawRtcDriftPage,
+        &DrawBootPage,
+#ifdef PROFILER_ENABLED
+        &DrawProfilerPage,
+#endif
     };
     
     if (gDisplayTimer == 0)
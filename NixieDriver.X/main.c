@@ -53,6 +53,10 @@ typedef union
 
 #define REFRESH_CATHODES_COMMAND 0xFF
 
+// Switches the cathodes off without the fade. The controller broadcasts this to every driver (I2C general call) when
+// the HV supply leaves its range. A cross-fade in progress is cut short within a millisecond (see RampCathodePins).
+#define BLANK_CATHODES_COMMAND 0xFE
+
 #define Byte2NixieCommand(b) ((NixieCommand)(b))
 #define Address2NixieCommand(a) Byte2NixieCommand((uint8_t)(((a >> 1) & 0x0F) | ((a << 3) & 0x80)))
 
@@ -136,8 +140,8 @@ void InitI2C()
     // 7-bit addressing client (25.4.5)
     SSP1CON1 = 0x06;
     
-    // Enable clock stretching (25.4.6)
-    SSP1CON2 = 0x01;
+    // Enable clock stretching and the general call address for broadcasts (25.4.6)
+    SSP1CON2 = 0x81;
     
     // No start/stop interrupts (25.4.7)
     SSP1CON3 = 0x00;
@@ -238,13 +242,33 @@ void SetPwmDutyCycle(int dc)
 //   If the pin # matches the selected digit, assign PWM 3 (increasing duty cycle, fade in)
 //   Otherwise, if the pin # matches the previously selected digit, assign PWM 4 (decreasing duty cycle, fade out)
 //   Otherwise, assign GPIO (off)
-#define ASSIGN_PPS(PPS, X) PPS = (X == command.digit) ? PPS_OUT_PWM3 : (X == lastCommand.digit) ? PPS_OUT_PWM4 : 0;
+#define ASSIGN_PPS(PPS, X) PPS = (X == command.digit) ? PPS_OUT_PWM3 : (X == gLastCommand.digit) ? PPS_OUT_PWM4 : 0;
 
-void RampCathodePins(NixieCommand command)
+static NixieCommand gLastCommand = { REFRESH_CATHODES_COMMAND };
+
+void BlankCathodePins()
 {
-    static NixieCommand lastCommand = { REFRESH_CATHODES_COMMAND };
+    SetPwmDutyCycle(0);
     
-    if (command._raw != lastCommand._raw)
+    CATHODE_0_PPS = 0;
+    CATHODE_1_PPS = 0;
+    CATHODE_2_PPS = 0;
+    CATHODE_3_PPS = 0;
+    CATHODE_4_PPS = 0;
+    CATHODE_5_PPS = 0;
+    CATHODE_6_PPS = 0;
+    CATHODE_7_PPS = 0;
+    CATHODE_8_PPS = 0;
+    CATHODE_9_PPS = 0;
+    CATHODE_COMMA_PIN = 0;
+    
+    // The next digit fades in from nothing.
+    gLastCommand._raw = BLANK_CATHODES_COMMAND;
+}
+
+void RampCathodePins(NixieCommand command)
+{
+    if (command._raw != gLastCommand._raw)
     {
         SetPwmDutyCycle(0);
 
@@ -264,7 +288,20 @@ void RampCathodePins(NixieCommand command)
         for (int pwm = 0; pwm <= PWM_MAX; pwm += PWM_RAMP_STEP_SIZE)
         {
             SetPwmDutyCycle(pwm);
-            __delay_ms(PWM_RAMP_STEP_INTERVAL);
+            
+            // The main loop doesn't see new commands until the fade is done, so watch for a blank here. It protects the
+            // tubes, so it can't wait.
+            for (int ms = 0; ms < PWM_RAMP_STEP_INTERVAL; ++ms)
+            {
+                if (gNewDataI2C && BLANK_CATHODES_COMMAND == gDataI2C)
+                {
+                    gNewDataI2C = 0;
+                    BlankCathodePins();
+                    return;
+                }
+                
+                __delay_ms(1);
+            }
         }
 
         // Set the duty cycle > max for 100% duty cycle
@@ -274,7 +311,7 @@ void RampCathodePins(NixieCommand command)
     // Light the comma if requested, but only if a digit is also lit.
     CATHODE_COMMA_PIN = command.comma && (command.digit <= 9);
     
-    lastCommand = command;
+    gLastCommand = command;
 }
 
 void UpdateCathodePins(NixieCommand command)
@@ -391,6 +428,7 @@ void main(void)
             gNewDataI2C = 0;
             
             if (REFRESH_CATHODES_COMMAND == command._raw) RefreshCathodes();
+            else if (BLANK_CATHODES_COMMAND == command._raw) BlankCathodePins();
             else RampCathodePins(command);
         }
         
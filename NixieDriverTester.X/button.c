@@ -11,6 +11,9 @@
 
 #define TRANSITION_TIME 5
 
+// Milliseconds
+#define LONG_PRESS_TIME 1000
+
 uint8_t gButtonState = BUTTON_STATE_RELEASED;
 uint8_t gLongPress = 0;
 
@@ -29,7 +32,7 @@ void InitButton(void)
 void UpdateButtonState(void)
 {
     static uint8_t gTransitionCounter = 0;
-    static uint32_t holdStartTick = 0;
+    static uint16_t holdStart = 0;
     
     uint8_t state = BUTTON_PIN;
     
@@ -40,7 +43,7 @@ void UpdateButtonState(void)
         gButtonState = state;
         gTransitionCounter = 0;
         
-        if (BUTTON_STATE_HELD == state) holdStartTick = gTickCount;
-        else gLongPress = gTickCount - holdStartTick > TICK_FREQ;
+        if (BUTTON_STATE_HELD == state) holdStart = Timer_GetMillis();
+        else gLongPress = Timer_MillisSince(holdStart) > LONG_PRESS_TIME;
     }
 }
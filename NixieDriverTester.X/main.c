@@ -53,6 +53,10 @@ typedef struct
 
 #define NIXIE_DIGIT_BLANK 0xF
 
+// Milliseconds each digit is shown for when auto-incrementing, and between display refreshes.
+#define DIGIT_TIME 1000
+#define DISPLAY_TIME 100
+
 uint8_t gNixieAutoIncrement = 1;
 NixieState gCurrentNixieState = { NIXIE_DIGIT_BLANK, 0, 0 };
 
@@ -64,6 +68,7 @@ void __interrupt() ISR()
     if (PIR1bits.SSP1IF || PIR1bits.BCL1IF) I2C_HandleInterrupt();
     
     if (PIR1bits.TMR2IF) TimerInterruptHandler();
+    if (PIR1bits.TMR1IF) Timer1InterruptHandler();
     
     if (PIR1bits.ADIF)
     {
@@ -85,6 +90,9 @@ void EnableInterrupts()
     
     // Enable the TMR2 interrupt for tick counting
     PIE1bits.TMR2IE = 1;
+    
+    // Enable the TMR1 interrupt for the microsecond timestamp
+    PIE1bits.TMR1IE = 1;
 
     // Enable ACD interrupt
     PIR1bits.ADIF = 0;
@@ -169,33 +177,33 @@ void DisplayNumber(uint16_t number, int8_t digitCount, uint8_t row, uint8_t x)
 
 void UpdateNixieState(void)
 {
-    static uint32_t nixieStartTickCount = 0;
-    static uint32_t commaToggleTickCount = (uint32_t)(~0);
-    static uint32_t buttonStartTickCount = 0;
+    static uint16_t nixieStart = 0;
+    static uint16_t commaToggle = 0;
+    static uint8_t commaTogglePending = 0;
 
     NixieState targetState = gCurrentNixieState;
     
     if (NIXIE_DIGIT_BLANK == gCurrentNixieState.digit)
     {
-        nixieStartTickCount = gTickCount;
+        nixieStart = Timer_GetMillis();
         targetState.digit = 0;
     }
 
     if (gNixieAutoIncrement)
     {
-        // This doesn't handle roll-over of the tick counter, but that's not important for this application.
-        if (gTickCount - nixieStartTickCount > TICK_FREQ)
+        if (Timer_MillisSince(nixieStart) > DIGIT_TIME)
         {
-            nixieStartTickCount = gTickCount;
-            commaToggleTickCount = nixieStartTickCount + TICK_FREQ / 2;
+            nixieStart = Timer_GetMillis();
+            commaToggle = nixieStart + DIGIT_TIME / 2;
+            commaTogglePending = 1;
             targetState.digit = (gCurrentNixieState.digit + 1) % 10;
         }
 
-        // Flip the comma state when the toggle tick count is reached.
-        if (gTickCount >= commaToggleTickCount)
+        // Flip the comma state half way through the digit.
+        if (commaTogglePending && Timer_Expired(commaToggle))
         {
             targetState.comma = gCurrentNixieState.comma ? 0 : 1;
-            commaToggleTickCount = (uint32_t)(~0);
+            commaTogglePending = 0;
         }
     }
 
@@ -225,13 +233,14 @@ void DrawStaticDisplaySymbols(void)
 
 void RefreshDisplay()
 {
-    uint32_t lastUpdateTick = 0;
-    if (gTickCount - lastUpdateTick < TMR2_FREQ / 10) return;
-    lastUpdateTick = gTickCount;
+    static uint16_t lastUpdate = 0;
+    uint16_t now = Timer_GetMillis();
+    if (TIMER_ELAPSED(lastUpdate, now) < DISPLAY_TIME) return;
+    lastUpdate = now;
     
-    // Scroll * vertically for proof of life
+    // Scroll * vertically (4 Hz) for proof of life
     for (uint8_t i = 0; i < 4; ++i)
-        DrawCharacter(i, 20, i == (gTickCount / (TMR2_FREQ / 40)) % 4 ? CHAR_AST : CHAR_SPC);
+        DrawCharacter(i, 20, i == (now / 250) % 4 ? CHAR_AST : CHAR_SPC);
     
     //
     // Nixie state
@@ -1,7 +1,12 @@
 #include "timer.h"
 #include "clock.h"
 
-uint32_t gTickCount = 0;
+// TMR2 interrupts counted toward the next millisecond, and the millisecond tick.
+static uint8_t gTimer2Count = 0;
+static volatile uint16_t gMillis = 0;
+
+// The high word of the microsecond timestamp, incremented on each TMR1 overflow.
+static volatile uint16_t gTimer1Overflows = 0;
 
 #if TMR2_RESET > 0xFF
 /*
@@ -13,13 +18,17 @@ uint32_t gTickCount = 0;
 #error Timer reset value to large for T2PR
 #endif
 
+#if TMR2_INTERRUPT_FREQ % 1000
+#error The TMR2 interrupt frequency must be a multiple of 1 kHz for the millisecond tick
+#endif
+
 void InitTimer()
 {
     // Use the F_osc/4 source, as required for PWM (21.10.5, 23.9)
     T2CLKCON = 0x1;
     
-    // Set the timer period (21.10.2)
-    T2PR = TMR2_RESET;
+    // Set the timer period (21.10.2). The period is T2PR + 1 counts, so the PWM and tick frequencies are exact.
+    T2PR = TMR2_RESET - 1;
     
     // Mode is free-running, period-pulse, software-gated (21.10.4)
     T2HLT = 0x00;    
@@ -30,10 +39,76 @@ void InitTimer()
     
     // Enable the timer
     T2CONbits.ON = 1;
+    
+    // TMR1 is a free-running timestamp counter: F_osc/4 with a 1:8 pre-scaler is 1 MHz at 32 MHz (20.11)
+    T1CLK = 0x1;
+    T1CONbits.CKPS = 0x3;
+    
+    // Latch TMR1H when TMR1L is read so 16-bit reads are consistent (20.5.2)
+    T1CONbits.RD16 = 1;
+    T1CONbits.ON = 1;
 }
 
 void TimerInterruptHandler(void)
 {
     PIR1bits.TMR2IF = 0;
-    ++gTickCount;
+    
+    if (++gTimer2Count >= TMR2_INTERRUPT_FREQ / 1000)
+    {
+        gTimer2Count = 0;
+        ++gMillis;
+    }
+}
+
+#pragma warning disable 1510 // ignore code duplication
+uint16_t Timer_GetMillis(void)
+{
+    // 16-bit reads aren't atomic on this core.
+    uint8_t gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    
+    uint16_t millis = gMillis;
+    
+    INTCONbits.GIE = gie;
+    
+    return millis;
+}
+
+uint16_t Timer_MillisSince(uint16_t start)
+{
+    return TIMER_ELAPSED(start, Timer_GetMillis());
+}
+
+uint8_t Timer_Expired(uint16_t deadline)
+{
+    return TIMER_DUE(deadline, Timer_GetMillis());
+}
+
+void Timer1InterruptHandler(void)
+{
+    PIR1bits.TMR1IF = 0;
+    ++gTimer1Overflows;
+}
+
+#pragma warning disable 1510 // ignore code duplication
+uint32_t Timer_GetMicros(void)
+{
+    // Hold off interrupts so the overflow count and the counter are sampled together. This is only a few cycles.
+    uint8_t gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    
+    uint16_t hi = gTimer1Overflows;
+    uint16_t lo = TMR1;
+    
+    // An overflow that hasn't been serviced yet belongs to the high word.
+    if (PIR1bits.TMR1IF && !(lo & 0x8000)) ++hi;
+    
+    INTCONbits.GIE = gie;
+    
+    return ((uint32_t)hi << 16) | lo;
+}
+
+uint32_t Timer_MicrosSince(uint32_t start)
+{
+    return Timer_GetMicros() - start;
 }